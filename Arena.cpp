@@ -1,214 +1,118 @@
 #include <iostream>
 #include <iomanip>
-#include <sstream>
 #include <fstream>
 #include <unistd.h>
 #include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <linux/seccomp.h>
+#include <linux/filter.h>
+#include <linux/audit.h>
+#include <fcntl.h>
+#include <cstddef>
 #include <sys/ioctl.h>
 #include <poll.h>
-#include <array>
 #include <random>
 #include <chrono>
-#include <omp.h>
 #include <limits>
-#include <algorithm>
-#include <map>
 #include <thread>
+#include <atomic>
 #include <csignal>
+#include <memory>
+#include <numeric>
+#include <tuple>
+#include "Replay.h"
+#include "Scheduler.h"
+#include "Strata.h"
 using namespace std;
 using namespace std::chrono;
 
-constexpr bool Debug_AI{false},Timeout{false};
+constexpr bool Timeout{false};
 constexpr int PIPE_READ{0},PIPE_WRITE{1};
-constexpr int N{2};//Number of players, 1v1
+constexpr int Exec_Failure_Code{127};//Exit code of a child which could not exec the bot, bots may exit with it too so exec failures are told apart by the status pipe
+constexpr int Max_Retries{3};//Times a game hit by an infrastructure failure is replayed with --infra retry
+constexpr double Starved_Share{0.5};//A bot which timed out while runnable after less CPU time than this share of its budget was starved by the machine
 constexpr double FirstTurnTime{1*(Timeout?1:10)},TimeLimit{0.05*(Timeout?1:10)};
-constexpr int W{23},H{21};
 
-bool stop{false};//Global flag to stop all arena threads when SIGTERM is received
-
-struct vec3{
-    int x,y,z;
+atomic<bool> stop{false};//Global flag to stop all arena threads when SIGTERM is received, read by every arena thread
+static_assert(ATOMIC_BOOL_LOCK_FREE==2,"stop is set from a signal handler");
+double Sample_Rate{1};//Fraction of turns kept when recording training samples
+volatile sig_atomic_t Thread_Delta{0};//Arena threads to add or remove, changed by SIGUSR1 and SIGUSR2
+#if defined(__x86_64__)
+constexpr bool Seccomp_Supported{true};
+constexpr uint32_t Seccomp_Arch{AUDIT_ARCH_X86_64};
+#elif defined(__aarch64__)
+constexpr bool Seccomp_Supported{true};
+constexpr uint32_t Seccomp_Arch{AUDIT_ARCH_AARCH64};
+#else
+constexpr bool Seccomp_Supported{false};//--single-thread is rejected, the filter below would check the wrong architecture
+constexpr uint32_t Seccomp_Arch{0};
+#endif
+
+struct bot_limits{//Applied to every bot process between fork and exec, 0 means unlimited
+    long memory{0};//Address space in MB
+    int cpu{0};//CPU seconds over a whole game
+    string cgroup;//cgroup v2 directory the bots are moved into
+    bool single_thread{false};//Forbid creating threads
 };
 
-struct vec{
-    int x,y;
-    inline void operator+=(const vec &a)noexcept{
-        x+=a.x;
-        y+=a.y;
-    }
-    inline vec operator*(const int a)const noexcept{
-        return vec{x*a,y*a};
-    }
-    inline vec operator+(const vec &a)const noexcept{
-        return vec{x+a.x,y+a.y};
-    }
-    inline vec operator-(const vec &a)const noexcept{
-        return vec{x-a.x,y-a.y};
-    }
-    inline bool operator==(const vec &a)const noexcept{
-        return x==a.x && y==a.y;
-    }
-    inline bool valid()const noexcept{
-        return x<W && y<H && x>=0 && y>=0;
-    }
-    inline vec3 toCube()const noexcept{
-        const int x3{x-(y-(y&1))/2};
-        return vec3{x3,-(x3+y),y};
-    }
-};
+bot_limits Limits;
+replay_filter Replay_Filter;
 
-struct vecf{
-    double x,y;
-    inline double norm2()const noexcept{
-        return pow(x,2)+pow(y,2);
-    }
-    inline double norm()const noexcept{
-        return sqrt(norm2());
-    }
-    inline void normalise()noexcept{
-        const double n{1.0/norm()};
-        x*=n;
-        y*=n;
-    }
-    inline double operator*(const vec &a)const noexcept{
-        return x*a.x+y*a.y;
-    }
-};
-
-constexpr array<vec,6> Move_Vec_Array_Even{vec{1,0},vec{0,-1},vec{-1,-1},vec{-1,0},vec{-1,1},vec{0,1}};
-constexpr array<vec,6> Move_Vec_Array_Odd{vec{1,0},vec{1,-1},vec{0,-1},vec{-1,0},vec{0,1},vec{1,1}};
-constexpr array<array<vec,6>,2> Move_Vec_Array{Move_Vec_Array_Even,Move_Vec_Array_Odd};
+enum infra_policy{COUNT,EXCLUDE,RETRY};//What to do with games ended by an infrastructure failure
 
-inline vec Move_Vec(const vec &r,const int angle)noexcept{
-    const bool odd{r.y%2!=0};
-    return Move_Vec_Array[odd][angle];
-}
+infra_policy Infra_Policy{COUNT};
 
-inline int Opposite_Angle(const int angle)noexcept{
-    return (angle+3)%6;
-}
-
-inline int Dist(const vec &a,const vec &b)noexcept{
-    vec3 a2=a.toCube(),b2=b.toCube();
-    return max({abs(a2.x-b2.x),abs(a2.y-b2.y),abs(a2.z-b2.z)});
-}
-
-inline vec Neighbour(const vec &r,const int angle)noexcept{
-    return r+Move_Vec(r,angle);
-}
-
-struct ship{
-    int id;
-    vec r;
-    int angle,speed,rum,owner,cd,mine_cd;
-    inline vec front()const noexcept{
-        return r+Move_Vec(r,angle);
-    }
-    inline vec back()const noexcept{
-        return r+Move_Vec(r,Opposite_Angle(angle));
-    }
-    inline void Blow(const vec &hit)noexcept{
-        if(hit==r){
-            rum=max(0,rum-50);
-        }
-        else if(hit==front() || hit==back()){
-            rum=max(0,rum-25);
-        }
-    }
-    inline bool IsBoat(const vec &a)const noexcept{
-        return a==r || a==back() || a==front();
-    }
-    inline void Splash(const vec &source)noexcept{
-        if(Dist(back(),source)<=1 || Dist(r,source)<=1 || Dist(front(),source)<=1){
-            rum-=10;
-        }
-    }
-};
-
-struct barrel{
-    int id;
-    vec r;
-    int rum;
+struct bot_usage{//Read from wait4 when the bot is reaped
+    long max_rss{0};//KB
+    double cpu{0};//Seconds of user and system time
 };
 
-struct cannonball{
-    int id,shooter_id;
-    vec target;
-    int turns;
+struct game_task{
+    array<string,N> Bot_Names;//In command line order
+    unsigned long long seed;//Determines the map
+    bool swap;//Bots play from swapped starting positions, the two games of a seed form a pair
+    int priority;
+    int stratum;//Index in Stratum to play both games of the pair on a map of that stratum, -1 for a single game on any map
+    int retries;
 };
 
-struct mine{
-    int id;
-    vec r;
+struct recorder{//Per thread recording buffers, null when not recording
+    sample_buffer *Samples;
+    replay *Replay;//Ring of the game being played
+    chunk_writer *Replays;//File the games matching Replay_Filter go to
 };
 
-struct state{
-    int entityId;
-    vector<ship> S;
-    vector<barrel> B;
-    vector<mine> M;
-    vector<cannonball> C;
-    inline void clear()noexcept{
-        B.clear();
-        M.clear();
-        S.clear();
-        C.clear();
-    }
-    inline void Purge()noexcept{
-        C.erase(remove_if(C.begin(),C.end(),[](const cannonball &c){return c.turns<=0;}),C.end());
-        S.erase(remove_if(S.begin(),S.end(),[](const ship &s){return s.rum<=0;}),S.end());
-    }
-    inline void Blow(const vec &hit)noexcept{
-        auto barrel_it=find_if(B.begin(),B.end(),[&](const barrel &b){return b.r==hit;});
-        auto mine_it=find_if(M.begin(),M.end(),[&](const mine &m){return m.r==hit;});
-        if(barrel_it!=B.end()){
-            B.erase(barrel_it);
-        }
-        else if(mine_it!=M.end()){
-            M.erase(mine_it);
-            for_each(S.begin(),S.end(),[&](ship &s){s.Splash(hit);});
+struct game_stats{
+    int games{0},draws{0};
+    array<double,N> points{};
+    array<bot_usage,N> usage{};//Peak RSS over all games and total CPU time, in command line order
+    array<stratum_stats,Strata> strata{};//Game pair scores of the first bot with --adaptive
+    array<int,Outcomes> outcomes{};//Games per outcome, including the excluded ones
+    inline void operator+=(const game_stats &a)noexcept{
+        games+=a.games;
+        draws+=a.draws;
+        for(int o=0;o<Outcomes;++o){
+            outcomes[o]+=a.outcomes[o];
+        }
+        for(int h=0;h<Strata;++h){
+            strata[h]+=a.strata[h];
         }
-        else{
-           for_each(S.begin(),S.end(),[&](ship &s){s.Blow(hit);}); 
+        for(int i=0;i<N;++i){
+            points[i]+=a.points[i];
+            usage[i].max_rss=max(usage[i].max_rss,a.usage[i].max_rss);
+            usage[i].cpu+=a.usage[i].cpu;
         }
     }
-    inline bool free(const vec &r)noexcept{
-        const bool no_barrel{find_if(B.begin(),B.end(),[&](const barrel &b){return b.r==r;})==B.end()};
-        const bool no_mine{find_if(M.begin(),M.end(),[&](const mine &m){return m.r==r;})==M.end()};
-        const bool no_ship{find_if(S.begin(),S.end(),[&](const ship &ship){return ship.IsBoat(r);})==S.end()};
-        return no_barrel && no_ship && no_mine;
+    inline game_stats Excluded()const noexcept{//What the games tell about the bots and the infrastructure, without their results
+        game_stats a;
+        a.usage=usage;
+        a.outcomes=outcomes;
+        return a;
     }
 };
 
-const array<string,8> MoveType2Str{"FIRE","MINE","PORT","STARBOARD","FASTER","SLOWER","WAIT","MOVE"};
-
-enum move_type{FIRE=0,MINE=1,PORT=2,STARBOARD=3,FASTER=4,SLOWER=5,WAIT=6,MOVE=7};
-
-struct play{
-    move_type type;
-    vec target;
-};
-
-typedef map<int,play> strat;
-
-inline ostream& operator<<(ostream &os,const vec &r)noexcept{
-    os << r.x << " " << r.y;
-    return os;
-}
-
-inline istream& operator>>(istream &is,vec &r)noexcept{
-    is >> r.x >> r.y;
-    return is;
-}
-
-inline ostream& operator<<(ostream &os,const play &mv)noexcept{
-    os << MoveType2Str[mv.type];
-    if(mv.type==FIRE){
-        os << " " << mv.target;
-    }
-    return os;
-}
-
 inline string EmptyPipe(const int fd){
     int nbytes;
     if(ioctl(fd,FIONREAD,&nbytes)<0){
@@ -223,20 +127,30 @@ inline string EmptyPipe(const int fd){
 }
 
 struct AI{
-    int id,pid,outPipe,errPipe,inPipe;
+    int id,pid{-1},outPipe{-1},errPipe{-1},inPipe{-1};//-1 until StartProcess succeeds
     string name;
+    bot_usage *usage{nullptr};//Filled in when the process is reaped
+    int status{0};//Wait status once reaped
+    bool starved{false};//Set by GetMove on a timeout
+    int exec_error{0};//errno of a failed exec, read from the status pipe
     inline void stop(){
         if(alive()){
-            kill(pid,SIGTERM);
-            int status;
-            waitpid(pid,&status,0);//It is necessary to read the exit code for the process to stop
+            kill(pid,SIGTERM);//No effect if the bot already died on its own, its status is kept
+            rusage ru;
+            if(wait4(pid,&status,0,&ru)==pid && usage!=nullptr){//It is necessary to read the exit code for the process to stop
+                usage->max_rss=ru.ru_maxrss;
+                usage->cpu=ru.ru_utime.tv_sec+ru.ru_stime.tv_sec+1e-6*(ru.ru_utime.tv_usec+ru.ru_stime.tv_usec);
+            }
             if(!WIFEXITED(status)){//If not exited normally try to "kill -9" the process
                 kill(pid,SIGKILL);
             }
         }
     }
     inline bool alive()const{
-        return kill(pid,0)!=-1;//Check if process is still running
+        return pid>0 && kill(pid,0)!=-1;//Check if process is still running, kill(0) or kill(-1) would signal other processes
+    }
+    inline game_outcome Death()const noexcept{//Why the reaped bot stopped answering
+        return exec_error!=0?EXEC_FAILURE:CRASH;
     }
     inline void Feed_Inputs(const string &inputs){
         if(write(inPipe,&inputs[0],inputs.size())!=inputs.size()){
@@ -244,69 +158,131 @@ struct AI{
         }
     }
     inline ~AI(){
-        close(errPipe);
-        close(outPipe);
-        close(inPipe);
+        for(const int fd:{errPipe,outPipe,inPipe}){
+            if(fd>=0){
+                close(fd);
+            }
+        }
         stop();
     }
 };
 
-void StartProcess(AI &Bot){
-    int StdinPipe[2];
-    int StdoutPipe[2];
-    int StderrPipe[2];
-    if(pipe(StdinPipe)<0){
-        perror("allocating pipe for child input redirect");
-    }
-    if(pipe(StdoutPipe)<0){
-        close(StdinPipe[PIPE_READ]);
-        close(StdinPipe[PIPE_WRITE]);
-        perror("allocating pipe for child output redirect");
-    }
-    if(pipe(StderrPipe)<0){
-        close(StderrPipe[PIPE_READ]);
-        close(StderrPipe[PIPE_WRITE]);
-        perror("allocating pipe for child stderr redirect failed");
+[[noreturn]] inline void Exec_Failed(const int status_fd,const char *what){//Called in the child when it cannot run the bot as asked, reports errno to the parent through the status pipe
+    const int err{errno};
+    perror(what);//Ends up in the bot's stderr
+    if(write(status_fd,&err,sizeof(err))!=sizeof(err)){//The parent then sees a crash
+    }
+    _exit(Exec_Failure_Code);//Never return into a copy of the arena
+}
+
+inline void ForbidThreads(const int status_fd){//seccomp filter failing clone with CLONE_THREAD, and clone3 so that libc falls back to clone
+#ifdef __NR_clone3
+    constexpr int clone3{__NR_clone3};
+#else
+    constexpr int clone3{-1};
+#endif
+    sock_filter filter[]{
+        BPF_STMT(BPF_LD|BPF_W|BPF_ABS,offsetof(seccomp_data,arch)),
+        BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K,Seccomp_Arch,1,0),
+        BPF_STMT(BPF_RET|BPF_K,SECCOMP_RET_ALLOW),
+        BPF_STMT(BPF_LD|BPF_W|BPF_ABS,offsetof(seccomp_data,nr)),
+        BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K,static_cast<uint32_t>(clone3),0,1),
+        BPF_STMT(BPF_RET|BPF_K,SECCOMP_RET_ERRNO|ENOSYS),
+        BPF_JUMP(BPF_JMP|BPF_JEQ|BPF_K,__NR_clone,0,3),
+        BPF_STMT(BPF_LD|BPF_W|BPF_ABS,offsetof(seccomp_data,args[0])),//Low 32 bits of the clone flags on little endian
+        BPF_JUMP(BPF_JMP|BPF_JSET|BPF_K,CLONE_THREAD,0,1),
+        BPF_STMT(BPF_RET|BPF_K,SECCOMP_RET_ERRNO|EPERM),
+        BPF_STMT(BPF_RET|BPF_K,SECCOMP_RET_ALLOW)
+    };
+    sock_fprog prog{static_cast<unsigned short>(sizeof(filter)/sizeof(filter[0])),filter};
+    if(prctl(PR_SET_NO_NEW_PRIVS,1,0,0,0)<0 || prctl(PR_SET_SECCOMP,SECCOMP_MODE_FILTER,&prog)<0){
+        Exec_Failed(status_fd,"installing the single thread seccomp filter");
+    }
+}
+
+inline void ApplyLimits(const int status_fd){//Called in the child process before exec, a bot is never run without its limits
+    if(Limits.memory>0){
+        const rlimit mem{static_cast<rlim_t>(Limits.memory)<<20,static_cast<rlim_t>(Limits.memory)<<20};
+        if(setrlimit(RLIMIT_AS,&mem)<0){
+            Exec_Failed(status_fd,"limiting bot memory");
+        }
+    }
+    if(Limits.cpu>0){
+        const rlimit cpu{static_cast<rlim_t>(Limits.cpu),static_cast<rlim_t>(Limits.cpu)+1};//SIGXCPU at the soft limit, SIGKILL at the hard one
+        if(setrlimit(RLIMIT_CPU,&cpu)<0){
+            Exec_Failed(status_fd,"limiting bot CPU time");
+        }
+    }
+    if(!Limits.cgroup.empty()){
+        const string procs{Limits.cgroup+"/cgroup.procs"},pid{to_string(getpid())};
+        const int fd{open(procs.c_str(),O_WRONLY)};
+        if(fd<0 || write(fd,pid.c_str(),pid.size())<0){
+            Exec_Failed(status_fd,"moving bot into its cgroup");
+        }
+        close(fd);
+    }
+    if(Limits.single_thread){
+        ForbidThreads(status_fd);
+    }
+}
+
+inline void Close_Pipes(initializer_list<int*> pipes){
+    for(int *p:pipes){
+        for(int end:{PIPE_READ,PIPE_WRITE}){
+            if(p[end]>=0){
+                close(p[end]);
+            }
+        }
+    }
+}
+
+bool StartProcess(AI &Bot){//False if the pipes or the process could not be created, typically EAGAIN on an overloaded machine
+    int StdinPipe[2]{-1,-1};
+    int StdoutPipe[2]{-1,-1};
+    int StderrPipe[2]{-1,-1};
+    int StatusPipe[2]{-1,-1};//Closed by a successful exec, carries errno if it fails
+    //O_CLOEXEC so that bots started by other arena threads do not inherit the pipes, which would keep them open after this bot dies
+    if(pipe2(StdinPipe,O_CLOEXEC)<0 || pipe2(StdoutPipe,O_CLOEXEC)<0 || pipe2(StderrPipe,O_CLOEXEC)<0 || pipe2(StatusPipe,O_CLOEXEC)<0){
+        perror("allocating pipes for the child");
+        Close_Pipes({StdinPipe,StdoutPipe,StderrPipe,StatusPipe});
+        return false;
     }
     int nchild{fork()};
-    if(nchild==0){//Child process
+    if(nchild==0){//Child process, dup2 clears O_CLOEXEC on the redirected std fds and exec closes the rest
         if(dup2(StdinPipe[PIPE_READ],STDIN_FILENO)==-1){// redirect stdin
-            perror("redirecting stdin");
-            return;
+            Exec_Failed(StatusPipe[PIPE_WRITE],"redirecting stdin");
         }
         if(dup2(StdoutPipe[PIPE_WRITE],STDOUT_FILENO)==-1){// redirect stdout
-            perror("redirecting stdout");
-            return;
+            Exec_Failed(StatusPipe[PIPE_WRITE],"redirecting stdout");
         }
         if(dup2(StderrPipe[PIPE_WRITE],STDERR_FILENO)==-1){// redirect stderr
-            perror("redirecting stderr");
-            return;
+            Exec_Failed(StatusPipe[PIPE_WRITE],"redirecting stderr");
         }
-        close(StdinPipe[PIPE_READ]);
-        close(StdinPipe[PIPE_WRITE]);
-        close(StdoutPipe[PIPE_READ]);
-        close(StdoutPipe[PIPE_WRITE]);
-        close(StderrPipe[PIPE_READ]);
-        close(StderrPipe[PIPE_WRITE]);
+        ApplyLimits(StatusPipe[PIPE_WRITE]);
         execl(Bot.name.c_str(),Bot.name.c_str(),(char*)NULL);//(char*)Null is really important
         //If you get past the previous line its an error
-        perror("exec of the child process");
+        Exec_Failed(StatusPipe[PIPE_WRITE],"exec of the child process");
     }
     else if(nchild>0){//Parent process
         close(StdinPipe[PIPE_READ]);//Parent does not read from stdin of child
         close(StdoutPipe[PIPE_WRITE]);//Parent does not write to stdout of child
         close(StderrPipe[PIPE_WRITE]);//Parent does not write to stderr of child
+        close(StatusPipe[PIPE_WRITE]);
+        int err;
+        if(read(StatusPipe[PIPE_READ],&err,sizeof(err))==sizeof(err)){//Blocks until the exec, EOF if it succeeded
+            Bot.exec_error=err;
+        }
+        close(StatusPipe[PIPE_READ]);
         Bot.inPipe=StdinPipe[PIPE_WRITE];
         Bot.outPipe=StdoutPipe[PIPE_READ];
         Bot.errPipe=StderrPipe[PIPE_READ];
         Bot.pid=nchild;
+        return true;
     }
     else{//failed to create child
-        close(StdinPipe[PIPE_READ]);
-        close(StdinPipe[PIPE_WRITE]);
-        close(StdoutPipe[PIPE_READ]);
-        close(StdoutPipe[PIPE_WRITE]);
         perror("Failed to create child process");
+        Close_Pipes({StdinPipe,StdoutPipe,StderrPipe,StatusPipe});
+        return false;
     }
 }
 
@@ -315,17 +291,46 @@ inline bool IsValidMove(const state &S,const AI &Bot,const string &M){
     return count(M.begin(),M.end(),'\n')==ships;//as many lines as ships
 }
 
-string GetMove(const state &S,AI &Bot,const int turn){
+inline bool Proc_Stat(const int pid,char &run_state,double &cpu){//Scheduler state and CPU time (user+system, all threads) of a process
+    ifstream in("/proc/"+to_string(pid)+"/stat");
+    string line;
+    getline(in,line);
+    const size_t name_end{line.rfind(')')};//The command name may contain spaces and parentheses
+    if(name_end==string::npos){
+        return false;
+    }
+    stringstream ss(line.substr(name_end+1));
+    unsigned long long field,utime,stime;
+    ss >> run_state;
+    for(int i=4;i<=13;++i){//ppid to cmajflt
+        ss >> field;
+    }
+    ss >> utime >> stime;
+    cpu=static_cast<double>(utime+stime)/sysconf(_SC_CLK_TCK);
+    return static_cast<bool>(ss);
+}
+
+void GetMove(const state &S,AI &Bot,const int turn,string &out){//out keeps what was read when it throws, for replays
     pollfd outpoll{Bot.outPipe,POLLIN};
+    char run_state;
+    double Start_Cpu;
+    const bool measured{Proc_Stat(Bot.pid,run_state,Start_Cpu)};
     time_point<system_clock> Start_Time{system_clock::now()};
-    string out;
     while(static_cast<duration<double>>(system_clock::now()-Start_Time).count()<(turn==1?FirstTurnTime:TimeLimit) && !IsValidMove(S,Bot,out)){
         double TimeLeft{(turn==1?FirstTurnTime:TimeLimit)-static_cast<duration<double>>(system_clock::now()-Start_Time).count()};
-        if(poll(&outpoll,1,TimeLeft)){
-            out+=EmptyPipe(Bot.outPipe);
+        if(poll(&outpoll,1,static_cast<int>(ceil(TimeLeft*1000)))>0){//poll takes milliseconds
+            const string read{EmptyPipe(Bot.outPipe)};
+            if(read.empty() && (outpoll.revents&(POLLHUP|POLLERR))){//stdout closed, the bot died
+                throw(3);
+            }
+            out+=read;
         }
     }
-    return out;
+    if(!IsValidMove(S,Bot,out)){
+        double End_Cpu;
+        Bot.starved=measured && Proc_Stat(Bot.pid,run_state,End_Cpu) && run_state=='R' && End_Cpu-Start_Cpu<Starved_Share*(turn==1?FirstTurnTime:TimeLimit);//Still waiting for a core rather than for input or a lock
+        throw(1);
+    }
 }
 
 inline bool Has_Won(const array<AI,N> &Bot,const int idx)noexcept{
@@ -349,371 +354,75 @@ inline bool All_Dead(const array<AI,N> &Bot)noexcept{
     return true;
 }
 
-template <bool verbose> void Simulate(state &S,const array<strat,2> &M){
-    map<int,int> RumToDrop;
-    for(ship &s:S.S){//Accelerations, decelerations, rum decrease
-        --s.rum;
-        RumToDrop[s.id]=min(30,s.rum);
-        const play &mv=M[s.owner].at(s.id);
-        if(mv.type==SLOWER){
-            s.speed=max(0,s.speed-1);
-        }
-        else if(mv.type==FASTER){
-            s.speed=min(2,s.speed+1);
-        }
-        else if(mv.type==FIRE && s.cd==0 && Dist(s.front(),mv.target)<=10){
-            S.C.push_back(cannonball{S.entityId++,s.id,mv.target,2+static_cast<int>(round(Dist(s.front(),mv.target)/3.0))});//2 because i move cannonballs after
-            s.cd=2;
-        }
-        else if(mv.type==MINE && s.mine_cd==0){
-            vec mine_spot=Neighbour(s.back(),Opposite_Angle(s.angle));
-            if(mine_spot.valid() && S.free(mine_spot)){
-                S.M.push_back(mine{S.entityId++,mine_spot});
-                s.mine_cd=5;
-            }
-        }
-        s.cd=max(0,s.cd-1);
-        s.mine_cd=max(0,s.mine_cd-1);
-    }
-    //Movement and collisions
-    for(int spd=1;spd<=2;++spd){
-        vector<ship> S_Before=S.S;
-        for(ship &s:S.S){
-            if(s.speed>=spd){
-                vec next=Neighbour(s.r,s.angle);
-                if(next.valid()){
-                    s.r=next;
-                }
-                else{
-                    s.speed=0;
-                }
-            }
-        }
-        while(true){
-            vector<int> colliding_boats;
-            for(int i=0;i<S.S.size();++i){
-                const ship &s=S.S[i];
-                if(s.speed>=spd){
-                    for(int j=0;j<S.S.size();++j){
-                        if(i!=j){//Don't check collisions with yourself
-                            const ship &s2=S.S[j];
-                            const vec new_front=s.front();
-                            if(s2.IsBoat(new_front)){//Collision
-                                colliding_boats.push_back(i);
-                                if(s2.front()==s.front()){
-                                    colliding_boats.push_back(j);
-                                }
-                            }
-                        }
-                    }
-                }
-            }
-            for(const int a:colliding_boats){
-                ship &s=S.S[a];
-                s.speed=0;//Stop ship
-                s.r=S_Before[a].r;//Put back in original position
-            }
-            if(colliding_boats.size()==0){
-                break;
-            }
-        }
-        for(ship &s:S.S){
-            if(s.speed>=spd){
-                const vec new_front=s.front();
-                auto barrel_it=find_if(S.B.begin(),S.B.end(),[&](const barrel &b){return b.r==new_front;});
-                if(barrel_it!=S.B.end()){
-                    const barrel &b=*barrel_it;
-                    s.rum=min(100,s.rum+b.rum);
-                    S.B.erase(barrel_it);
-                }
-                auto mine_it=find_if(S.M.begin(),S.M.end(),[&](const mine &m){return m.r==new_front;});
-                if(mine_it!=S.M.end()){
-                    s.rum-=25;
-                    for_each(S.S.begin(),S.S.end(),[&](ship &s2){if(s2.id!=s.id)s2.Splash(mine_it->r);});
-                    S.M.erase(mine_it);
-                }
-            }
-        }
-    }
-    //Turns
-    vector<ship> S_Before=S.S;
-    for(ship &s:S.S){
-        const play &mv=M[s.owner].at(s.id);
-        if(mv.type==STARBOARD || mv.type==PORT){//Rotation
-            if(mv.type==STARBOARD){
-                s.angle=s.angle==0?5:s.angle-1;
-            }
-            else if(mv.type==PORT){
-                s.angle=s.angle==5?0:s.angle+1;
-            }
-        }
-    }
-    while(true){
-        vector<int> colliding_boats;
-        for(int i=0;i<S.S.size();++i){
-            const ship &s=S.S[i];
-            const play &mv=M[s.owner].at(s.id);
-            if(mv.type==STARBOARD || mv.type==PORT){//Rotation
-                for(int j=0;j<S.S.size();++j){
-                    if(j!=i){//Don't check collision with yourself
-                        const ship &s2=S.S[j];
-                        const vec new_front=s.front(),new_front2=s2.front(),new_back=s.back(),new_back2=s2.back();
-                        if(s.IsBoat(new_front2) || s2.IsBoat(new_front) || s.IsBoat(new_back2) || s2.IsBoat(new_back)){//Collision
-                            colliding_boats.push_back(i);
-                            colliding_boats.push_back(j);
-                        } 
-                    }
-                }
-            }
-        }
-        for(const int a:colliding_boats){
-            ship &s=S.S[a];
-            s.speed=0;//Stop ship
-            s.angle=S_Before[a].angle;
-        }
-        if(colliding_boats.size()==0){
-            break;
-        }
-    }
-    for(ship &s:S.S){
-        const play &mv=M[s.owner].at(s.id);
-        if(mv.type==STARBOARD || mv.type==PORT){//Rotation
-            const vec new_front=s.front(),new_back=s.back();
-            auto barrel_it=find_if(S.B.begin(),S.B.end(),[&](const barrel &b){return b.r==new_front || b.r==new_back;});
-            if(barrel_it!=S.B.end()){
-                const barrel &b=*barrel_it;
-                s.rum=min(100,s.rum+b.rum);
-                S.B.erase(barrel_it);
-            }
-            auto mine_it=find_if(S.M.begin(),S.M.end(),[&](const mine &m){return m.r==new_front || m.r==new_back;});
-            if(mine_it!=S.M.end()){
-                s.rum-=25;
-                for_each(S.S.begin(),S.S.end(),[&](ship &s2){if(s2.id!=s.id)s2.Splash(mine_it->r);});
-                S.M.erase(mine_it);
-            }
-        }
-    }
-    for(cannonball &c:S.C){
-        --c.turns;
-        if(c.turns==0){
-            S.Blow(c.target);
-        }
-    }
-    for(const ship &s:S.S){
-        if(s.rum<=0 && RumToDrop[s.id]>0){
-            S.B.push_back(barrel{S.entityId++,s.r,RumToDrop[s.id]});
-        }
-    }
-    S.Purge();
-}
-
-inline bool Player_Alive(const state &S,const int player)noexcept{
-    return find_if(S.S.begin(),S.S.end(),[&](const ship &s){return s.owner==player;})!=S.S.end();
-}
-
-inline double Angle(const vec &a,const vec &b)noexcept{//Angle from a to b, taken from referee
-    const double dy =(b.y-a.y)*sqrt(3)/2;
-    const double dx = b.x-a.x+((a.y-b.y)&1)*0.5;
-    double angle=-atan2(dy,dx)*3/M_PI;
-    if(angle<0){
-        angle+=6;
-    }else if(angle>=6){
-        angle-=6;
-    }
-    return angle;
-}
-
-play Basic_Move(const state &S,const ship &s,const vec &target){//Translated from CG referee
-    if(s.r==target || s.speed==2){
-        return {SLOWER};
-    }
-    else if(s.speed==1){
-        vec n=Neighbour(s.r,s.angle);
-        if(!n.valid()){//Hitting edge of map
-            return {SLOWER};
-        }
-        if(n==target){// Target reached at next turn
-            return {WAIT};
-        }
 
-        const double targetAngle{Angle(s.r,target)};
-        const double angleStraight{min(abs(s.angle-targetAngle),6-abs(s.angle-targetAngle))};
-        const double anglePort{min(abs((s.angle+1)-targetAngle),abs((s.angle-5)-targetAngle))};
-        const double angleStarboard{min(abs((s.angle+5)-targetAngle),abs((s.angle-1)-targetAngle))};
-
-        const double centerAngle{Angle(s.r,vec{W/2,H/2})};
-        const double anglePortCenter{min(abs((s.angle+1)-centerAngle),abs((s.angle-5)-centerAngle))};
-        const double angleStarboardCenter{min(abs((s.angle+5)-centerAngle),abs((s.angle-1)-centerAngle))};
-        if(Dist(s.r,target)==1 && angleStraight>1.5){// Next to target with bad angle, slow down then rotate (avoid to turn around the target!)
-            return {SLOWER};
-        }
-        int min_dist{Dist(n,target)};
-        play best_move{WAIT};
-        //Test port
-        vec nextPort=Neighbour(s.r,(s.angle+1)%6);
-        if(nextPort.valid()){
-            const int dist{Dist(nextPort,target)};
-            if(dist<min_dist || (dist==min_dist && anglePort<angleStraight-0.5) ){
-                min_dist=dist;
-                best_move={PORT};
-            }
-        }
-        // Test starboard
-        vec nextStarboard=Neighbour(s.r,(s.angle+5)%6);
-        if(nextStarboard.valid()){
-            const int dist{Dist(nextStarboard,target)};
-            if(dist<min_dist
-                    || (dist==min_dist && angleStarboard<anglePort-0.5 && best_move.type==PORT)
-                    || (dist==min_dist && angleStarboard<angleStraight-0.5 && best_move.type==WAIT)
-                    || (dist==min_dist && best_move.type==PORT && angleStarboard==anglePort
-                            && angleStarboardCenter<anglePortCenter)
-                    || (dist==min_dist && best_move.type==PORT && angleStarboard==anglePort
-                            && angleStarboardCenter==anglePortCenter && (s.angle==1||s.angle==4))){
-                min_dist=dist;
-                best_move={STARBOARD};
-            }
-        }
-        return best_move;
-    }
-    else if(s.speed==0){
-        const double targetAngle{Angle(s.r,target)};
-        const double angleStraight{min(abs(s.angle-targetAngle),6-abs(s.angle-targetAngle))};
-        const double anglePort{min(abs((s.angle+1)-targetAngle),abs((s.angle-5)-targetAngle))};
-        const double angleStarboard{min(abs((s.angle+5)-targetAngle),abs((s.angle-1)-targetAngle))};
-
-        const double centerAngle{Angle(s.r,vec{W/2,H/2})};
-        const double anglePortCenter{min(abs((s.angle+1)-centerAngle),abs((s.angle-5)-centerAngle))};
-        const double angleStarboardCenter{min(abs((s.angle+5)-centerAngle),abs((s.angle-1)-centerAngle))};
-
-        vec n=Neighbour(s.r,s.angle);
-        play best_move{WAIT};
-        if(anglePort<=angleStarboard){
-            best_move={PORT};
-        }
-        if(angleStarboard<anglePort || angleStarboard==anglePort && angleStarboardCenter<anglePortCenter
-                || angleStarboard==anglePort && angleStarboardCenter==anglePortCenter && (s.angle==1 || s.angle==4)){
-            best_move={STARBOARD};
-        }
-        if(n.valid() && angleStraight<=anglePort && angleStraight<=angleStarboard){
-            best_move={FASTER};
-        }
-        return best_move;
-    }
-}
-
-strat StringToStrat(const state &S,const AI &Bot,const string &M_str){
-    strat M;
-    vector<int> Boat_Id;
-    for(const ship &s:S.S){
-        if(s.owner==Bot.id){
-            Boat_Id.push_back(s.id);
-        }
-    }
-    stringstream ss(M_str);
-    for(const int id:Boat_Id){
-        string line,type;
-        getline(ss,line);
-        stringstream ss2(line);
-        ss2 >> type;
-        if(type=="FIRE"){
-            vec target;
-            ss2 >> target;
-            M[id]=play{FIRE,target};
-        }
-        else if(type=="MINE"){
-            M[id]=play{MINE};
-        }
-        else if(type=="FASTER"){
-            M[id]=play{FASTER};
-        }
-        else if(type=="SLOWER"){
-            M[id]=play{SLOWER};
-        }
-        else if(type=="PORT"){
-            M[id]=play{PORT};
-        }
-        else if(type=="STARBOARD"){
-            M[id]=play{STARBOARD};
-        }
-        else if(type=="WAIT"){
-            M[id]=play{WAIT};
-        }
-        else if(type=="MOVE"){
-            vec target;
-            ss2 >> target;
-            M[id]=Basic_Move(S,*find_if(S.S.begin(),S.S.end(),[&](const ship &s){return s.id==id;}),target);
-        }
-        else{
-            cerr << "Invalid move from AI " << Bot.name << ": " << M_str << endl;
-            throw(2);
-        }
-    }
-    return M;
-}
-
-int Play_Game(const array<string,N> &Bot_Names,state &S){
+int Play_Game(const array<string,N> &Bot_Names,state &S,vector<sample> *History,replay *Replay,array<bot_usage,N> &Usage,game_outcome &Outcome){
     array<AI,N> Bot;
     for(int i=0;i<N;++i){
         Bot[i].id=i;
         Bot[i].name=Bot_Names[i];
-        StartProcess(Bot[i]);
+        Bot[i].usage=&Usage[i];
+        if(!StartProcess(Bot[i])){//The bot never plays, as if it had died
+            cerr << "Arena failed to start AI " << Bot[i].name << endl;
+            Outcome=ARENA_ERROR;
+        }
     }
     int turn{0};
     while(++turn>0 && !stop){
         array<strat,2> M;
+        array<string,N> Output,Error;
         for(int i=0;i<N;++i){
             if(Bot[i].alive()){
-                stringstream ss;
-                const int playerShips{static_cast<int>(count_if(S.S.begin(),S.S.end(),[&](const ship &s){return s.owner==Bot[i].id;}))};
-                vector<mine> Visible_Mines;
-                for(const mine &m:S.M){
-                    bool visible{false};
-                    for(const ship &s:S.S){
-                        if(s.owner==Bot[i].id && Dist(s.r,m.r)<=5){
-                            visible=true;
-                            break;
-                        }
-                    }
-                    if(visible){
-                        Visible_Mines.push_back(m);
-                    }
-                }
-                ss << playerShips << endl;
-                ss << S.S.size()+Visible_Mines.size()+S.C.size()+S.B.size() << endl;
-                for(const ship &s:S.S){
-                    ss << s.id << " " << "SHIP" << " " << s.r << " " << s.angle << " " << s.speed << " " << s.rum << " " << (s.owner==Bot[i].id?1:0) << endl;
-                }
-                for(const mine &m:Visible_Mines){
-                    ss << m.id << " " << "MINE" << " " << m.r << " " << -1 << " " << -1 << " " << -1 << " " << -1 << endl;
-                }
-                for(const cannonball &c:S.C){
-                    ss << c.id << " " << "CANNONBALL" << " " << c.target << " " << c.shooter_id << " " << c.turns << " " << -1 << " " << -1 << endl;
-                }
-                for(const barrel &b:S.B){
-                    ss << b.id << " " << "BARREL" << " " << b.r << " " << b.rum << " " << -1 << " " << -1 << " " << -1 << endl; 
-                }
                 try{
-                    Bot[i].Feed_Inputs(ss.str());
-                    M[i]=StringToStrat(S,Bot[i],GetMove(S,Bot[i],turn));
+                    Bot[i].Feed_Inputs(Turn_Inputs(S,i));
+                    GetMove(S,Bot[i],turn,Output[i]);
+                    M[i]=StringToStrat(S,i,Bot[i].name,Output[i]);
                     //cerr << M[i] << endl;
                 }
                 catch(int ex){
+                    game_outcome type{INVALID};
+                    Bot[i].stop();
                     if(ex==1){//Timeout
-                        cerr << "Loss by Timeout of AI " << Bot[i].id << " name: " << Bot[i].name << endl;
+                        type=Bot[i].starved?OVERLOAD:TIMEOUT;
+                        cerr << "Loss by Timeout of AI " << Bot[i].id << " name: " << Bot[i].name << (type==OVERLOAD?" starved of CPU time":"") << endl;
                     }
-                    else if(ex==5){
-                        cerr << "AI " << Bot[i].name << " died before being able to give it inputs" << endl;
+                    else if(ex==3 || ex==5){//Closed its stdout or stdin
+                        type=Bot[i].Death();
+                        cerr << "AI " << Bot[i].name;
+                        if(type==EXEC_FAILURE){
+                            cerr << " could not be started: " << strerror(Bot[i].exec_error);
+                        }
+                        else{
+                            cerr << " died";
+                        }
+                        if(WIFSIGNALED(Bot[i].status)){
+                            cerr << " by signal " << strsignal(WTERMSIG(Bot[i].status));
+                        }
+                        cerr << endl;
+                    }
+                    else if(ex==4){//Reading a pipe failed on the arena side
+                        type=ARENA_ERROR;
+                        cerr << "Arena failed to read the output of AI " << Bot[i].name << endl;
+                    }
+                    if(Outcome==NORMAL){
+                        Outcome=type;
                     }
-                    Bot[i].stop();
                 }
             }
         }
-        for(int i=0;i<2;++i){
-            string err_str{EmptyPipe(Bot[i].errPipe)};
-            if(Debug_AI){
-                ofstream err_out("log.txt",ios::app);
-                err_out << err_str << endl;
+        for(int i=0;i<N;++i){
+            if(Bot[i].errPipe>=0){
+                Error[i]=EmptyPipe(Bot[i].errPipe);
             }
+        }
+        if(Replay!=nullptr){
+            Replay->outcome=Outcome;
+            replay_turn &T=Replay->Next();
+            T.turn=turn;
+            T.S=S;
+            T.output=move(Output);
+            T.error=move(Error);
+        }
+        for(int i=0;i<2;++i){
             if(Has_Won(Bot,i)){
                 //cerr << i << " has won in " << turn << " turns" << endl;
                 return i;
@@ -722,6 +431,9 @@ int Play_Game(const array<string,N> &Bot_Names,state &S){
         if(All_Dead(Bot)){
             return -1;
         }
+        if(History!=nullptr){
+            History->push_back(sample{turn,0,S,M});
+        }
         Simulate<false>(S,M);
         for(int i=0;i<N;++i){
             if(!Player_Alive(S,i)){
@@ -745,52 +457,46 @@ int Play_Game(const array<string,N> &Bot_Names,state &S){
     return -2;
 }
 
-int Play_Round(array<string,N> Bot_Names){
-    default_random_engine generator(system_clock::now().time_since_epoch().count());
-    uniform_int_distribution<int> Swap_Distrib(0,1);
-    const bool player_swap{Swap_Distrib(generator)==1};
+int Play_Round(const game_task &T,recorder &Rec,array<bot_usage,N> &Usage,game_outcome &Outcome){
+    default_random_engine generator(T.seed);
+    array<string,N> Bot_Names{T.Bot_Names};
+    const bool player_swap{T.swap};
     if(player_swap){
         swap(Bot_Names[0],Bot_Names[1]);
     }
 
-    uniform_int_distribution<int> Ship_Count(1,3),Mine_Count(5,10),Barrel_Count(10,26),Angle_Distrib(0,5);
-    state S;
-    S.entityId=0;
-    const int shipsPerPlayer{Ship_Count(generator)},mines{Mine_Count(generator)},barrels{Barrel_Count(generator)};
-
-    for(int i=0;i<shipsPerPlayer;++i){
-        const int xMin{1+i*W/shipsPerPlayer},xMax{(i+1)*W/shipsPerPlayer-2};
-        uniform_int_distribution<int> X_Distrib(xMin,xMax),Y_Distrib(1,H/2-2);
-        const vec r{X_Distrib(generator),Y_Distrib(generator)};
-        const int angle{Angle_Distrib(generator)};
-        S.S.push_back({S.entityId++,r,angle,0,100,0,0,0});//id,pos,angle,speed,rum,owner,cd
-        S.S.push_back({S.entityId++,vec{r.x,H-1-r.y},(6-angle)%6,0,100,1,0,0});
+    uniform_int_distribution<int> Ship_Count(1,Max_Ships),Mine_Count(5,10),Barrel_Count(10,26);
+    if(T.stratum>=0){//Same distributions restricted to the stratum
+        const map_stratum &h=Stratum[T.stratum];
+        Ship_Count=uniform_int_distribution<int>(h.ships,h.ships);
+        Mine_Count=uniform_int_distribution<int>(h.min_mines,h.max_mines);
+        Barrel_Count=uniform_int_distribution<int>(h.min_barrels,h.max_barrels);
     }
-
-    while(S.M.size()<mines){
-        uniform_int_distribution<int> X_Distrib(1,W-2),Y_Distrib(1,H/2);
-        const vec r{X_Distrib(generator),Y_Distrib(generator)};
-        if(S.free(r)){
-            if(r.y!=H-1-r.y){
-                S.M.push_back(mine{S.entityId++,vec{r.x,H-1-r.y}});
+    const int shipsPerPlayer{Ship_Count(generator)},mines{Mine_Count(generator)},barrels{Barrel_Count(generator)};
+    state S{Generate_Map(generator,shipsPerPlayer,mines,barrels)};
+    if(Rec.Replay!=nullptr){
+        Rec.Replay->Clear();
+        Rec.Replay->seed=T.seed;
+        Rec.Replay->stratum=T.stratum;
+        Rec.Replay->names=Bot_Names;
+    }
+    vector<sample> History;
+    int winner{Play_Game(Bot_Names,S,Rec.Samples!=nullptr?&History:nullptr,Rec.Replay,Usage,Outcome)};
+    if(winner!=-2){//Games interrupted by SIGTERM have no outcome
+        bernoulli_distribution Keep_Distrib(Sample_Rate);
+        for(sample &smp:History){
+            if(Keep_Distrib(generator)){
+                smp.winner=winner;
+                Rec.Samples->Push(smp);
             }
-            S.M.push_back(mine{S.entityId++,r});
         }
     }
-
-    while(S.B.size()<barrels){
-        uniform_int_distribution<int> X_Distrib(1,W-2),Y_Distrib(1,H/2),Rum_Distrib(10,20);
-        const vec r{X_Distrib(generator),Y_Distrib(generator)};
-        const int rum{Rum_Distrib(generator)};
-        if(S.free(r)){
-            if(r.y!=H-1-r.y){
-                S.B.push_back({S.entityId++,vec{r.x,H-1-r.y},rum});
-            }
-            S.B.push_back({S.entityId++,r,rum});
-        }
+    if(Rec.Replay!=nullptr){
+        Rec.Replay->winner=winner;
+        Rec.Replay->final=S;
     }
-    int winner{Play_Game(Bot_Names,S)};
     if(player_swap){
+        swap(Usage[0],Usage[1]);
         return winner==-1?-1:winner==0?1:0;
     }
     else{
@@ -798,19 +504,149 @@ int Play_Round(array<string,N> Bot_Names){
     }
 }
 
+int Play_Task(const game_task &T,recorder &Rec,game_stats &stats){//Plays one game, returns the winner in command line order or -3 if it is excluded
+    game_stats game;
+    game_outcome outcome{NORMAL};
+    const int winner{Play_Round(T,Rec,game.usage,outcome)};
+    if(winner==-2){//Interrupted by stop
+        return winner;
+    }
+    ++game.outcomes[outcome];
+    if(Rec.Replay!=nullptr && Replay_Filter.Match(*Rec.Replay,winner)){
+        string raw;
+        Encode(raw,*Rec.Replay);
+        Rec.Replays->Write_Chunk(raw,1);
+    }
+    if(winner==-1){//Draw
+        ++game.draws;
+        game.points[0]+=0.5;
+        game.points[1]+=0.5;
+    }
+    else{//Win
+        ++game.points[winner];
+    }
+    ++game.games;
+    if(Infrastructure_Failure(outcome) && Infra_Policy!=COUNT){
+        stats+=game.Excluded();
+        return -3;
+    }
+    stats+=game;
+    return winner;
+}
+
+void Print_Outcomes(const game_stats &total){//Counts of abnormal outcomes, ends the report line
+    for(int o=NORMAL+1;o<Outcomes;++o){
+        if(total.outcomes[o]>0){
+            cout << " " << Outcome2Str[o] << ":" << total.outcomes[o];
+        }
+    }
+    cout << (Infra_Policy!=COUNT?" (infrastructure failures excluded)":"") << endl;
+}
+
 void StopArena(const int signum){
     stop=true;
 }
 
+void ResizeArena(const int signum){
+    Thread_Delta+=signum==SIGUSR1?1:-1;
+}
+
 int main(int argc,char **argv){
     if(argc<3){
         cerr << "Program takes 2 inputs, the names of the AIs fighting each other" << endl;
         return 0;
     }
+    const int Max_Threads{2*max(1,static_cast<int>(thread::hardware_concurrency()))};
     int N_Threads{1};
-    if(argc>=4){//Optional N_Threads parameter
-        N_Threads=min(2*omp_get_num_procs(),max(1,atoi(argv[3])));
-        cerr << "Running " << N_Threads << " arena threads" << endl;
+    string Sample_File;
+    int Max_Games{0};
+    unsigned long long Seed=system_clock::now().time_since_epoch().count();
+    bool Adaptive{false};
+    string Replay_File;
+    for(int i=3;i<argc;++i){
+        const string arg{argv[i]};
+        if(arg=="--record" && i+1<argc){//Record training samples to a file
+            Sample_File=argv[++i];
+        }
+        else if(arg=="--games" && i+1<argc){//Stop after this many games
+            Max_Games=max(0,atoi(argv[++i]));
+        }
+        else if(arg=="--seed" && i+1<argc){//Seed of the first map, the following games use the next seeds
+            Seed=stoull(argv[++i]);
+        }
+        else if(arg=="--memory" && i+1<argc){//Address space limit of each bot in MB
+            Limits.memory=max(0,atoi(argv[++i]));
+        }
+        else if(arg=="--cpu" && i+1<argc){//CPU seconds a bot may use in a game
+            Limits.cpu=max(0,atoi(argv[++i]));
+        }
+        else if(arg=="--cgroup" && i+1<argc){//Existing cgroup v2 directory to put bots in
+            Limits.cgroup=argv[++i];
+        }
+        else if(arg=="--single-thread"){
+            if(!Seccomp_Supported){
+                cerr << "--single-thread is only supported on x86_64 and aarch64" << endl;
+                return 0;
+            }
+            Limits.single_thread=true;
+        }
+        else if(arg=="--adaptive"){//Play more maps from the strata where the bots' results vary
+            Adaptive=true;
+        }
+        else if(arg=="--replay" && i+1<argc){//Record the turns of every game, write the ones matching the filter
+            Replay_File=argv[++i];
+        }
+        else if(arg=="--replay-on" && i+1<argc){//Comma separated list of loss, draw, error or outcome names
+            stringstream ss(argv[++i]);
+            string category;
+            while(getline(ss,category,',')){
+                if(!Replay_Filter.Add(category)){
+                    cerr << "Unknown replay category " << category << endl;
+                    return 0;
+                }
+            }
+        }
+        else if(arg=="--infra" && i+1<argc){//count, exclude or retry games ended by exec failures, arena errors or an overloaded machine
+            const string policy{argv[++i]};
+            if(policy=="count"){
+                Infra_Policy=COUNT;
+            }
+            else if(policy=="exclude"){
+                Infra_Policy=EXCLUDE;
+            }
+            else if(policy=="retry"){
+                Infra_Policy=RETRY;
+            }
+            else{
+                cerr << "Unknown infrastructure failure policy " << policy << ", expected count, exclude or retry" << endl;
+                return 0;
+            }
+        }
+        else if(arg=="--replay-seeds" && i+1<argc){//Comma separated list of seeds whose games are always written
+            stringstream ss(argv[++i]);
+            string seed;
+            while(getline(ss,seed,',')){
+                Replay_Filter.seeds.push_back(stoull(seed));
+            }
+        }
+        else if(arg=="--sample-rate" && i+1<argc){
+            Sample_Rate=min(1.0,max(0.0,atof(argv[++i])));
+        }
+        else if(arg.compare(0,2,"--")!=0){//Optional N_Threads parameter
+            N_Threads=min(Max_Threads,max(1,atoi(argv[i])));
+        }
+        else{
+            cerr << "Unknown option " << arg << endl;
+            return 0;
+        }
+    }
+    if(Adaptive && Max_Games==1){
+        cerr << "--adaptive plays whole pairs, --games must be at least 2" << endl;
+        return 0;
+    }
+    if(Adaptive && Max_Games%2==1){
+        --Max_Games;
+        cerr << "--adaptive plays whole pairs, playing " << Max_Games << " games" << endl;
     }
     array<string,N> Bot_Names;
     for(int i=0;i<2;++i){
@@ -829,31 +665,144 @@ int main(int argc,char **argv){
         }
         Test.close();
     }
+    if(!Limits.cgroup.empty()){//Checked here since a bot failing to join it only shows in the bot's stderr
+        const string procs{Limits.cgroup+"/cgroup.procs"};
+        const int fd{open(procs.c_str(),O_WRONLY)};
+        if(fd<0){
+            cerr << "Cannot move bots into the cgroup, opening " << procs << " failed: " << strerror(errno) << endl;
+            return 0;
+        }
+        close(fd);
+    }
     signal(SIGTERM,StopArena);//Register SIGTERM signal handler so the arena can cleanup when you kill it
     signal(SIGPIPE,SIG_IGN);//Ignore SIGPIPE to avoid the arena crashing when an AI crashes
-    int games{0},draws{0};
-    array<double,2> points{0,0};
-    #pragma omp parallel num_threads(N_Threads) shared(games,points,Bot_Names)
-    while(!stop){
-        const int winner{Play_Round(Bot_Names)};
-        if(winner==-1){//Draw
-            #pragma omp atomic
-            ++draws;
-            #pragma omp atomic
-            points[0]+=0.5;
-            #pragma omp atomic
-            points[1]+=0.5;
-        }
-        else{//Win
-            #pragma omp atomic
-            ++points[winner];
-        }
-        #pragma omp atomic
-        ++games;
-        double p{static_cast<double>(points[0])/games};
-        double sigma{sqrt(p*(1-p)/games)};
+    signal(SIGUSR1,ResizeArena);//kill -USR1 adds an arena thread, kill -USR2 removes one
+    signal(SIGUSR2,ResizeArena);
+    unique_ptr<chunk_writer> Writer;
+    if(!Sample_File.empty()){
+        Writer.reset(new chunk_writer(Sample_File));
+        if(!Writer->good()){
+            return 0;
+        }
+        cerr << "Recording " << Sample_Rate*100 << "% of turns to " << Sample_File << endl;
+    }
+    unique_ptr<chunk_writer> Replays;
+    if(!Replay_File.empty()){
+        Replays.reset(new chunk_writer(Replay_File,Replay_Magic));
+        if(!Replays->good()){
+            return 0;
+        }
+        if(Replay_Filter.Empty()){
+            Replay_Filter.Add("loss");
+            Replay_Filter.Add("error");
+        }
+    }
+    int generated{0};
+    scheduler<game_task,game_stats> Arena(Max_Threads,stop);
+    default_random_engine Stratum_Generator(Seed);
+    Arena.Generate=[&](vector<game_task> &batch){
+        const int task_games{Adaptive?2:1};//An adaptive task is a whole pair
+        if(Adaptive && Max_Games>0 && generated+task_games>Max_Games){
+            return false;
+        }
+        if(Adaptive){
+            const game_stats total{Arena.Totals()};
+            array<double,Strata> share;
+            for(int h=0;h<Strata;++h){
+                share[h]=Neyman_Weight(h,total.strata[h]);
+            }
+            discrete_distribution<int> Stratum_Distrib(share.begin(),share.end());
+            batch.push_back(game_task{Bot_Names,Seed,false,0,Stratum_Distrib(Stratum_Generator),0});
+            generated+=2;
+        }
+        else{
+            for(const bool swap:{false,true}){
+                if(Max_Games==0 || generated<Max_Games){
+                    batch.push_back(game_task{Bot_Names,Seed,swap,0,-1,0});
+                    ++generated;
+                }
+            }
+        }
+        ++Seed;
+        return Max_Games==0 || generated+task_games<=Max_Games;
+    };
+    Arena.Run=[&](const game_task &T){
+        thread_local unique_ptr<sample_buffer> Buffer;//Flushed when the thread exits
+        thread_local unique_ptr<replay> Replay;
+        if(Writer && !Buffer){
+            Buffer.reset(new sample_buffer(*Writer));
+        }
+        if(Replays && !Replay){
+            Replay.reset(new replay);
+        }
+        recorder Rec{Buffer.get(),Replay.get(),Replays.get()};
+        game_stats delta;
+        bool excluded{false};
+        if(T.stratum<0){
+            excluded=Play_Task(T,Rec,delta)==-3;
+        }
+        else{
+            game_stats pair;
+            double score{0};
+            for(const bool swap:{false,true}){
+                game_task side{T};
+                side.swap=swap;
+                const int winner{Play_Task(side,Rec,pair)};
+                if(winner==-2){//A pair cut short by stop is left out of the stratum
+                    delta+=pair;
+                    return delta;
+                }
+                if(winner==-3){//Both games of the pair go, or the other side would be counted twice on a retry
+                    excluded=true;
+                    break;
+                }
+                score+=winner==-1?0.25:winner==0?0.5:0;
+            }
+            if(excluded){
+                delta+=pair.Excluded();
+            }
+            else{
+                pair.strata[T.stratum].Add(score);
+                delta+=pair;
+            }
+        }
+        if(excluded && Infra_Policy==RETRY && T.retries<Max_Retries && !stop){
+            game_task retry{T};
+            ++retry.retries;
+            ++retry.priority;//Ahead of new games so that the retried maps are not underrepresented when the run is stopped
+            Arena.Submit(retry);
+        }
+        return delta;
+    };
+    Arena.Report=[&](const game_stats &total){
+        if(stop){
+            return;
+        }
+        if(total.games==0){//Every game so far was excluded
+            cout << "No game counted yet";
+            Print_Outcomes(total);
+            return;
+        }
+        double p{static_cast<double>(total.points[0])/total.games};
+        double sigma{sqrt(p*(1-p)/total.games)};
+        if(Adaptive){
+            tie(p,sigma)=Stratified_Estimate(total.strata);
+        }
         double better{0.5+0.5*erf((p-0.5)/(sqrt(2)*sigma))};
-        #pragma omp critical
-        cout << "Wins:" << setprecision(4) << 100*p << "+-" << 100*sigma << "% Rounds:" << games << " Draws:" << draws << " " << better*100 << "% chance that " << Bot_Names[0] << " is better" << endl;
+        cout << "Wins:" << setprecision(4) << 100*p << "+-" << 100*sigma << "% Rounds:" << total.games << " Draws:" << total.draws << " " << better*100 << "% chance that " << Bot_Names[0] << " is better";
+        cout << " Peak RSS:" << total.usage[0].max_rss/1024 << "/" << total.usage[1].max_rss/1024 << "MB CPU/game:" << total.usage[0].cpu/total.games << "/" << total.usage[1].cpu/total.games << "s";
+        Print_Outcomes(total);
+    };
+    Arena.Resize(N_Threads);
+    cerr << "Running " << Arena.Threads() << " arena threads" << endl;
+    while(!Arena.Finished()){
+        this_thread::sleep_for(milliseconds(100));
+        if(Thread_Delta!=0){
+            const int delta{Thread_Delta};
+            Thread_Delta-=delta;
+            N_Threads=min(Max_Threads,max(1,N_Threads+delta));
+            Arena.Resize(N_Threads);
+            cerr << "Running " << Arena.Threads() << " arena threads" << endl;
+        }
     }
-}
\ No newline at end of file
+}
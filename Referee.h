@@ -0,0 +1,655 @@
+#pragma once
+//Game rules of Coders of the Caribbean, shared by the arena and the tools built around it.
+//The board size, player count and ship cap are template parameters (board) of the functions which depend on them,
+//defaulting to the game played on CodinGame, so the simulator can be stress tested on bigger variants.
+#include <iostream>
+#include <sstream>
+#include <array>
+#include <vector>
+#include <map>
+#include <string>
+#include <cmath>
+#include <algorithm>
+#include <random>
+using namespace std;
+
+template <int width,int height,int players,int max_ships,int index_ships=16> struct board{
+    static constexpr int W{width},H{height};
+    static constexpr int N{players};
+    static constexpr int Max_Ships{max_ships};//Per player
+    static constexpr int Index_Ships{index_ships};//Ships on the map from which collisions are found with a ship_grid rather than by testing every pair
+};
+template <int width,int height,int players,int max_ships,int index_ships> constexpr int board<width,height,players,max_ships,index_ships>::W;
+template <int width,int height,int players,int max_ships,int index_ships> constexpr int board<width,height,players,max_ships,index_ships>::H;
+template <int width,int height,int players,int max_ships,int index_ships> constexpr int board<width,height,players,max_ships,index_ships>::N;
+template <int width,int height,int players,int max_ships,int index_ships> constexpr int board<width,height,players,max_ships,index_ships>::Max_Ships;
+template <int width,int height,int players,int max_ships,int index_ships> constexpr int board<width,height,players,max_ships,index_ships>::Index_Ships;
+
+typedef board<23,21,2,3> default_board;
+
+constexpr int N{default_board::N};//Number of players, 1v1
+constexpr int W{default_board::W},H{default_board::H};
+constexpr int Max_Ships{default_board::Max_Ships};
+
+struct vec3{
+    int x,y,z;
+};
+
+struct vec{
+    int x,y;
+    inline void operator+=(const vec &a)noexcept{
+        x+=a.x;
+        y+=a.y;
+    }
+    inline vec operator*(const int a)const noexcept{
+        return vec{x*a,y*a};
+    }
+    inline vec operator+(const vec &a)const noexcept{
+        return vec{x+a.x,y+a.y};
+    }
+    inline vec operator-(const vec &a)const noexcept{
+        return vec{x-a.x,y-a.y};
+    }
+    inline bool operator==(const vec &a)const noexcept{
+        return x==a.x && y==a.y;
+    }
+    inline vec3 toCube()const noexcept{
+        const int x3{x-(y-(y&1))/2};
+        return vec3{x3,-(x3+y),y};
+    }
+};
+
+template <class Board> inline bool Valid(const vec &r)noexcept{//On the map of Board
+    return r.x<Board::W && r.y<Board::H && r.x>=0 && r.y>=0;
+}
+
+struct vecf{
+    double x,y;
+    inline double norm2()const noexcept{
+        return pow(x,2)+pow(y,2);
+    }
+    inline double norm()const noexcept{
+        return sqrt(norm2());
+    }
+    inline void normalise()noexcept{
+        const double n{1.0/norm()};
+        x*=n;
+        y*=n;
+    }
+    inline double operator*(const vec &a)const noexcept{
+        return x*a.x+y*a.y;
+    }
+};
+
+constexpr array<vec,6> Move_Vec_Array_Even{vec{1,0},vec{0,-1},vec{-1,-1},vec{-1,0},vec{-1,1},vec{0,1}};
+constexpr array<vec,6> Move_Vec_Array_Odd{vec{1,0},vec{1,-1},vec{0,-1},vec{-1,0},vec{0,1},vec{1,1}};
+constexpr array<array<vec,6>,2> Move_Vec_Array{Move_Vec_Array_Even,Move_Vec_Array_Odd};
+
+inline vec Move_Vec(const vec &r,const int angle)noexcept{
+    const bool odd{r.y%2!=0};
+    return Move_Vec_Array[odd][angle];
+}
+
+inline int Opposite_Angle(const int angle)noexcept{
+    return (angle+3)%6;
+}
+
+inline int Dist(const vec &a,const vec &b)noexcept{
+    vec3 a2=a.toCube(),b2=b.toCube();
+    return max({abs(a2.x-b2.x),abs(a2.y-b2.y),abs(a2.z-b2.z)});
+}
+
+inline vec Neighbour(const vec &r,const int angle)noexcept{
+    return r+Move_Vec(r,angle);
+}
+
+struct ship{
+    int id;
+    vec r;
+    int angle,speed,rum,owner,cd,mine_cd;
+    inline vec front()const noexcept{
+        return r+Move_Vec(r,angle);
+    }
+    inline vec back()const noexcept{
+        return r+Move_Vec(r,Opposite_Angle(angle));
+    }
+    inline void Blow(const vec &hit)noexcept{
+        if(hit==r){
+            rum=max(0,rum-50);
+        }
+        else if(hit==front() || hit==back()){
+            rum=max(0,rum-25);
+        }
+    }
+    inline bool IsBoat(const vec &a)const noexcept{
+        return a==r || a==back() || a==front();
+    }
+    inline void Splash(const vec &source)noexcept{
+        if(Dist(back(),source)<=1 || Dist(r,source)<=1 || Dist(front(),source)<=1){
+            rum-=10;
+        }
+    }
+};
+
+struct barrel{
+    int id;
+    vec r;
+    int rum;
+};
+
+struct cannonball{
+    int id,shooter_id;
+    vec target;
+    int turns;
+};
+
+struct mine{
+    int id;
+    vec r;
+};
+
+struct state{
+    int entityId;
+    vector<ship> S;
+    vector<barrel> B;
+    vector<mine> M;
+    vector<cannonball> C;
+    inline void clear()noexcept{
+        B.clear();
+        M.clear();
+        S.clear();
+        C.clear();
+    }
+    inline void Purge()noexcept{
+        C.erase(remove_if(C.begin(),C.end(),[](const cannonball &c){return c.turns<=0;}),C.end());
+        S.erase(remove_if(S.begin(),S.end(),[](const ship &s){return s.rum<=0;}),S.end());
+    }
+    inline void Blow(const vec &hit)noexcept{
+        auto barrel_it=find_if(B.begin(),B.end(),[&](const barrel &b){return b.r==hit;});
+        auto mine_it=find_if(M.begin(),M.end(),[&](const mine &m){return m.r==hit;});
+        if(barrel_it!=B.end()){
+            B.erase(barrel_it);
+        }
+        else if(mine_it!=M.end()){
+            M.erase(mine_it);
+            for_each(S.begin(),S.end(),[&](ship &s){s.Splash(hit);});
+        }
+        else{
+           for_each(S.begin(),S.end(),[&](ship &s){s.Blow(hit);}); 
+        }
+    }
+    inline bool free(const vec &r)noexcept{
+        const bool no_barrel{find_if(B.begin(),B.end(),[&](const barrel &b){return b.r==r;})==B.end()};
+        const bool no_mine{find_if(M.begin(),M.end(),[&](const mine &m){return m.r==r;})==M.end()};
+        const bool no_ship{find_if(S.begin(),S.end(),[&](const ship &ship){return ship.IsBoat(r);})==S.end()};
+        return no_barrel && no_ship && no_mine;
+    }
+};
+
+const array<string,8> MoveType2Str{"FIRE","MINE","PORT","STARBOARD","FASTER","SLOWER","WAIT","MOVE"};
+
+enum move_type{FIRE=0,MINE=1,PORT=2,STARBOARD=3,FASTER=4,SLOWER=5,WAIT=6,MOVE=7};
+
+struct play{
+    move_type type;
+    vec target;
+};
+
+typedef map<int,play> strat;
+
+inline ostream& operator<<(ostream &os,const vec &r)noexcept{
+    os << r.x << " " << r.y;
+    return os;
+}
+
+inline istream& operator>>(istream &is,vec &r)noexcept{
+    is >> r.x >> r.y;
+    return is;
+}
+
+inline ostream& operator<<(ostream &os,const play &mv)noexcept{
+    os << MoveType2Str[mv.type];
+    if(mv.type==FIRE){
+        os << " " << mv.target;
+    }
+    return os;
+}
+
+template <class Board> class ship_grid{//Ships covering each cell, built only once there are enough ships for it to beat testing every pair
+    static constexpr int Stride{Board::W+2};//Padded by a cell on every side since bows and sterns can stick out of the map
+    bool indexed;
+    vector<int> first,next,index;//Linked list per cell of the ships (index) covering it
+    vector<int> used;//Cells to reset on the next Build
+    inline static int Cell(const vec &r)noexcept{
+        return (r.y+1)*Stride+r.x+1;
+    }
+public:
+    inline ship_grid(const int ships):indexed{ships>=Board::Index_Ships}{
+        if(indexed){
+            first.assign(Stride*(Board::H+2),-1);
+        }
+    }
+    inline void Build(const vector<ship> &S){
+        if(!indexed){
+            return;
+        }
+        for(const int c:used){
+            first[c]=-1;
+        }
+        used.clear();
+        next.clear();
+        index.clear();
+        for(int i=0;i<S.size();++i){
+            for(const vec &r:{S[i].r,S[i].front(),S[i].back()}){
+                const int c{Cell(r)};
+                if(first[c]==-1){
+                    used.push_back(c);
+                }
+                next.push_back(first[c]);
+                index.push_back(i);
+                first[c]=index.size()-1;
+            }
+        }
+    }
+    template <class F> inline void For_Each_Near(const vector<ship> &S,const initializer_list<vec> cells,F f)const{//Calls f(j) at least once for every ship j covering one of the cells, and maybe for others
+        if(!indexed){
+            for(int j=0;j<S.size();++j){
+                f(j);
+            }
+            return;
+        }
+        for(const vec &r:cells){
+            for(int e=first[Cell(r)];e!=-1;e=next[e]){
+                f(index[e]);
+            }
+        }
+    }
+};
+
+template <bool verbose,class Board=default_board> void Simulate(state &S,const array<strat,Board::N> &M){
+    map<int,int> RumToDrop;
+    for(ship &s:S.S){//Accelerations, decelerations, rum decrease
+        --s.rum;
+        RumToDrop[s.id]=min(30,s.rum);
+        const play &mv=M[s.owner].at(s.id);
+        if(mv.type==SLOWER){
+            s.speed=max(0,s.speed-1);
+        }
+        else if(mv.type==FASTER){
+            s.speed=min(2,s.speed+1);
+        }
+        else if(mv.type==FIRE && s.cd==0 && Dist(s.front(),mv.target)<=10){
+            S.C.push_back(cannonball{S.entityId++,s.id,mv.target,2+static_cast<int>(round(Dist(s.front(),mv.target)/3.0))});//2 because i move cannonballs after
+            s.cd=2;
+        }
+        else if(mv.type==MINE && s.mine_cd==0){
+            vec mine_spot=Neighbour(s.back(),Opposite_Angle(s.angle));
+            if(Valid<Board>(mine_spot) && S.free(mine_spot)){
+                S.M.push_back(mine{S.entityId++,mine_spot});
+                s.mine_cd=5;
+            }
+        }
+        s.cd=max(0,s.cd-1);
+        s.mine_cd=max(0,s.mine_cd-1);
+    }
+    //Movement and collisions
+    ship_grid<Board> Grid(S.S.size());//Colliding ships are put back, never removed, so the grid is rebuilt in place
+    for(int spd=1;spd<=2;++spd){
+        vector<ship> S_Before=S.S;
+        for(ship &s:S.S){
+            if(s.speed>=spd){
+                vec next=Neighbour(s.r,s.angle);
+                if(Valid<Board>(next)){
+                    s.r=next;
+                }
+                else{
+                    s.speed=0;
+                }
+            }
+        }
+        while(true){
+            vector<int> colliding_boats;//Stopping a ship twice is harmless, so the order and duplicates don't matter
+            Grid.Build(S.S);
+            for(int i=0;i<S.S.size();++i){
+                const ship &s=S.S[i];
+                if(s.speed>=spd){
+                    const vec new_front=s.front();
+                    Grid.For_Each_Near(S.S,{new_front},[&](const int j){
+                        if(i!=j){//Don't check collisions with yourself
+                            const ship &s2=S.S[j];
+                            if(s2.IsBoat(new_front)){//Collision
+                                colliding_boats.push_back(i);
+                                if(s2.front()==s.front()){
+                                    colliding_boats.push_back(j);
+                                }
+                            }
+                        }
+                    });
+                }
+            }
+            for(const int a:colliding_boats){
+                ship &s=S.S[a];
+                s.speed=0;//Stop ship
+                s.r=S_Before[a].r;//Put back in original position
+            }
+            if(colliding_boats.size()==0){
+                break;
+            }
+        }
+        for(ship &s:S.S){
+            if(s.speed>=spd){
+                const vec new_front=s.front();
+                auto barrel_it=find_if(S.B.begin(),S.B.end(),[&](const barrel &b){return b.r==new_front;});
+                if(barrel_it!=S.B.end()){
+                    const barrel &b=*barrel_it;
+                    s.rum=min(100,s.rum+b.rum);
+                    S.B.erase(barrel_it);
+                }
+                auto mine_it=find_if(S.M.begin(),S.M.end(),[&](const mine &m){return m.r==new_front;});
+                if(mine_it!=S.M.end()){
+                    s.rum-=25;
+                    for_each(S.S.begin(),S.S.end(),[&](ship &s2){if(s2.id!=s.id)s2.Splash(mine_it->r);});
+                    S.M.erase(mine_it);
+                }
+            }
+        }
+    }
+    //Turns
+    vector<ship> S_Before=S.S;
+    for(ship &s:S.S){
+        const play &mv=M[s.owner].at(s.id);
+        if(mv.type==STARBOARD || mv.type==PORT){//Rotation
+            if(mv.type==STARBOARD){
+                s.angle=s.angle==0?5:s.angle-1;
+            }
+            else if(mv.type==PORT){
+                s.angle=s.angle==5?0:s.angle+1;
+            }
+        }
+    }
+    while(true){
+        vector<int> colliding_boats;
+        Grid.Build(S.S);
+        for(int i=0;i<S.S.size();++i){
+            const ship &s=S.S[i];
+            const play &mv=M[s.owner].at(s.id);
+            if(mv.type==STARBOARD || mv.type==PORT){//Rotation
+                Grid.For_Each_Near(S.S,{s.r,s.front(),s.back()},[&](const int j){//Colliding ships share a cell
+                    if(j!=i){//Don't check collision with yourself
+                        const ship &s2=S.S[j];
+                        const vec new_front=s.front(),new_front2=s2.front(),new_back=s.back(),new_back2=s2.back();
+                        if(s.IsBoat(new_front2) || s2.IsBoat(new_front) || s.IsBoat(new_back2) || s2.IsBoat(new_back)){//Collision
+                            colliding_boats.push_back(i);
+                            colliding_boats.push_back(j);
+                        } 
+                    }
+                });
+            }
+        }
+        for(const int a:colliding_boats){
+            ship &s=S.S[a];
+            s.speed=0;//Stop ship
+            s.angle=S_Before[a].angle;
+        }
+        if(colliding_boats.size()==0){
+            break;
+        }
+    }
+    for(ship &s:S.S){
+        const play &mv=M[s.owner].at(s.id);
+        if(mv.type==STARBOARD || mv.type==PORT){//Rotation
+            const vec new_front=s.front(),new_back=s.back();
+            auto barrel_it=find_if(S.B.begin(),S.B.end(),[&](const barrel &b){return b.r==new_front || b.r==new_back;});
+            if(barrel_it!=S.B.end()){
+                const barrel &b=*barrel_it;
+                s.rum=min(100,s.rum+b.rum);
+                S.B.erase(barrel_it);
+            }
+            auto mine_it=find_if(S.M.begin(),S.M.end(),[&](const mine &m){return m.r==new_front || m.r==new_back;});
+            if(mine_it!=S.M.end()){
+                s.rum-=25;
+                for_each(S.S.begin(),S.S.end(),[&](ship &s2){if(s2.id!=s.id)s2.Splash(mine_it->r);});
+                S.M.erase(mine_it);
+            }
+        }
+    }
+    for(cannonball &c:S.C){
+        --c.turns;
+        if(c.turns==0){
+            S.Blow(c.target);
+        }
+    }
+    for(const ship &s:S.S){
+        if(s.rum<=0 && RumToDrop[s.id]>0){
+            S.B.push_back(barrel{S.entityId++,s.r,RumToDrop[s.id]});
+        }
+    }
+    S.Purge();
+}
+
+inline bool Player_Alive(const state &S,const int player)noexcept{
+    return find_if(S.S.begin(),S.S.end(),[&](const ship &s){return s.owner==player;})!=S.S.end();
+}
+
+inline double Angle(const vec &a,const vec &b)noexcept{//Angle from a to b, taken from referee
+    const double dy =(b.y-a.y)*sqrt(3)/2;
+    const double dx = b.x-a.x+((a.y-b.y)&1)*0.5;
+    double angle=-atan2(dy,dx)*3/M_PI;
+    if(angle<0){
+        angle+=6;
+    }else if(angle>=6){
+        angle-=6;
+    }
+    return angle;
+}
+
+template <class Board=default_board> inline play Basic_Move(const state &S,const ship &s,const vec &target){//Translated from CG referee
+    constexpr int W{Board::W},H{Board::H};
+    if(s.r==target || s.speed==2){
+        return {SLOWER};
+    }
+    else if(s.speed==1){
+        vec n=Neighbour(s.r,s.angle);
+        if(!Valid<Board>(n)){//Hitting edge of map
+            return {SLOWER};
+        }
+        if(n==target){// Target reached at next turn
+            return {WAIT};
+        }
+
+        const double targetAngle{Angle(s.r,target)};
+        const double angleStraight{min(abs(s.angle-targetAngle),6-abs(s.angle-targetAngle))};
+        const double anglePort{min(abs((s.angle+1)-targetAngle),abs((s.angle-5)-targetAngle))};
+        const double angleStarboard{min(abs((s.angle+5)-targetAngle),abs((s.angle-1)-targetAngle))};
+
+        const double centerAngle{Angle(s.r,vec{W/2,H/2})};
+        const double anglePortCenter{min(abs((s.angle+1)-centerAngle),abs((s.angle-5)-centerAngle))};
+        const double angleStarboardCenter{min(abs((s.angle+5)-centerAngle),abs((s.angle-1)-centerAngle))};
+        if(Dist(s.r,target)==1 && angleStraight>1.5){// Next to target with bad angle, slow down then rotate (avoid to turn around the target!)
+            return {SLOWER};
+        }
+        int min_dist{Dist(n,target)};
+        play best_move{WAIT};
+        //Test port
+        vec nextPort=Neighbour(s.r,(s.angle+1)%6);
+        if(Valid<Board>(nextPort)){
+            const int dist{Dist(nextPort,target)};
+            if(dist<min_dist || (dist==min_dist && anglePort<angleStraight-0.5) ){
+                min_dist=dist;
+                best_move={PORT};
+            }
+        }
+        // Test starboard
+        vec nextStarboard=Neighbour(s.r,(s.angle+5)%6);
+        if(Valid<Board>(nextStarboard)){
+            const int dist{Dist(nextStarboard,target)};
+            if(dist<min_dist
+                    || (dist==min_dist && angleStarboard<anglePort-0.5 && best_move.type==PORT)
+                    || (dist==min_dist && angleStarboard<angleStraight-0.5 && best_move.type==WAIT)
+                    || (dist==min_dist && best_move.type==PORT && angleStarboard==anglePort
+                            && angleStarboardCenter<anglePortCenter)
+                    || (dist==min_dist && best_move.type==PORT && angleStarboard==anglePort
+                            && angleStarboardCenter==anglePortCenter && (s.angle==1||s.angle==4))){
+                min_dist=dist;
+                best_move={STARBOARD};
+            }
+        }
+        return best_move;
+    }
+    else if(s.speed==0){
+        const double targetAngle{Angle(s.r,target)};
+        const double angleStraight{min(abs(s.angle-targetAngle),6-abs(s.angle-targetAngle))};
+        const double anglePort{min(abs((s.angle+1)-targetAngle),abs((s.angle-5)-targetAngle))};
+        const double angleStarboard{min(abs((s.angle+5)-targetAngle),abs((s.angle-1)-targetAngle))};
+
+        const double centerAngle{Angle(s.r,vec{W/2,H/2})};
+        const double anglePortCenter{min(abs((s.angle+1)-centerAngle),abs((s.angle-5)-centerAngle))};
+        const double angleStarboardCenter{min(abs((s.angle+5)-centerAngle),abs((s.angle-1)-centerAngle))};
+
+        vec n=Neighbour(s.r,s.angle);
+        play best_move{WAIT};
+        if(anglePort<=angleStarboard){
+            best_move={PORT};
+        }
+        if(angleStarboard<anglePort || angleStarboard==anglePort && angleStarboardCenter<anglePortCenter
+                || angleStarboard==anglePort && angleStarboardCenter==anglePortCenter && (s.angle==1 || s.angle==4)){
+            best_move={STARBOARD};
+        }
+        if(Valid<Board>(n) && angleStraight<=anglePort && angleStraight<=angleStarboard){
+            best_move={FASTER};
+        }
+        return best_move;
+    }
+}
+
+template <class Board=default_board> inline strat StringToStrat(const state &S,const int player,const string &name,const string &M_str){
+    strat M;
+    vector<int> Boat_Id;
+    for(const ship &s:S.S){
+        if(s.owner==player){
+            Boat_Id.push_back(s.id);
+        }
+    }
+    stringstream ss(M_str);
+    for(const int id:Boat_Id){
+        string line,type;
+        getline(ss,line);
+        stringstream ss2(line);
+        ss2 >> type;
+        if(type=="FIRE"){
+            vec target;
+            ss2 >> target;
+            M[id]=play{FIRE,target};
+        }
+        else if(type=="MINE"){
+            M[id]=play{MINE};
+        }
+        else if(type=="FASTER"){
+            M[id]=play{FASTER};
+        }
+        else if(type=="SLOWER"){
+            M[id]=play{SLOWER};
+        }
+        else if(type=="PORT"){
+            M[id]=play{PORT};
+        }
+        else if(type=="STARBOARD"){
+            M[id]=play{STARBOARD};
+        }
+        else if(type=="WAIT"){
+            M[id]=play{WAIT};
+        }
+        else if(type=="MOVE"){
+            vec target;
+            ss2 >> target;
+            M[id]=Basic_Move<Board>(S,*find_if(S.S.begin(),S.S.end(),[&](const ship &s){return s.id==id;}),target);
+        }
+        else{
+            cerr << "Invalid move from AI " << name << ": " << M_str << endl;
+            throw(2);
+        }
+    }
+    return M;
+}
+
+inline string Turn_Inputs(const state &S,const int player){//What the player is given at the start of a turn
+    stringstream ss;
+    const int playerShips{static_cast<int>(count_if(S.S.begin(),S.S.end(),[&](const ship &s){return s.owner==player;}))};
+    vector<mine> Visible_Mines;
+    for(const mine &m:S.M){
+        bool visible{false};
+        for(const ship &s:S.S){
+            if(s.owner==player && Dist(s.r,m.r)<=5){
+                visible=true;
+                break;
+            }
+        }
+        if(visible){
+            Visible_Mines.push_back(m);
+        }
+    }
+    ss << playerShips << endl;
+    ss << S.S.size()+Visible_Mines.size()+S.C.size()+S.B.size() << endl;
+    for(const ship &s:S.S){
+        ss << s.id << " " << "SHIP" << " " << s.r << " " << s.angle << " " << s.speed << " " << s.rum << " " << (s.owner==player?1:0) << endl;
+    }
+    for(const mine &m:Visible_Mines){
+        ss << m.id << " " << "MINE" << " " << m.r << " " << -1 << " " << -1 << " " << -1 << " " << -1 << endl;
+    }
+    for(const cannonball &c:S.C){
+        ss << c.id << " " << "CANNONBALL" << " " << c.target << " " << c.shooter_id << " " << c.turns << " " << -1 << " " << -1 << endl;
+    }
+    for(const barrel &b:S.B){
+        ss << b.id << " " << "BARREL" << " " << b.r << " " << b.rum << " " << -1 << " " << -1 << " " << -1 << endl;
+    }
+    return ss.str();
+}
+
+template <class Board=default_board> inline state Generate_Map(default_random_engine &generator,const int shipsPerPlayer,const int mines,const int barrels){//Symmetric map, mines and barrels are placed in mirrored pairs until there are at least as many as requested
+    //With more than 2 players every player gets the same ships in its own band of rows and mines and barrels are placed anywhere
+    constexpr int W{Board::W},H{Board::H},N{Board::N};
+    constexpr int Band{N==2?H/2:H/N/2*2};//Rows per player, even with more than 2 players so ships keep their shape when shifted on the hexagonal grid
+    static_assert(W>=3*Board::Max_Ships,"Generate_Map needs 3 columns per ship, shipsPerPlayer must not exceed Max_Ships");
+    static_assert(Band>=3,"Generate_Map needs 3 rows per player");
+    uniform_int_distribution<int> Angle_Distrib(0,5);
+    state S;
+    S.entityId=0;
+
+    for(int i=0;i<shipsPerPlayer;++i){
+        const int xMin{1+i*W/shipsPerPlayer},xMax{(i+1)*W/shipsPerPlayer-2};
+        uniform_int_distribution<int> X_Distrib(xMin,xMax),Y_Distrib(1,Band-2);
+        const vec r{X_Distrib(generator),Y_Distrib(generator)};
+        const int angle{Angle_Distrib(generator)};
+        S.S.push_back({S.entityId++,r,angle,0,100,0,0,0});//id,pos,angle,speed,rum,owner,cd
+        if(N==2){
+            S.S.push_back({S.entityId++,vec{r.x,H-1-r.y},(6-angle)%6,0,100,1,0,0});
+        }
+        for(int player=1;player<N && N>2;++player){
+            S.S.push_back({S.entityId++,vec{r.x,r.y+player*Band},angle,0,100,player,0,0});
+        }
+    }
+
+    while(S.M.size()<mines){
+        uniform_int_distribution<int> X_Distrib(1,W-2),Y_Distrib(1,N==2?H/2:H-2);
+        const vec r{X_Distrib(generator),Y_Distrib(generator)};
+        if(S.free(r)){
+            if(N==2 && r.y!=H-1-r.y){
+                S.M.push_back(mine{S.entityId++,vec{r.x,H-1-r.y}});
+            }
+            S.M.push_back(mine{S.entityId++,r});
+        }
+    }
+
+    while(S.B.size()<barrels){
+        uniform_int_distribution<int> X_Distrib(1,W-2),Y_Distrib(1,N==2?H/2:H-2),Rum_Distrib(10,20);
+        const vec r{X_Distrib(generator),Y_Distrib(generator)};
+        const int rum{Rum_Distrib(generator)};
+        if(S.free(r)){
+            if(N==2 && r.y!=H-1-r.y){
+                S.B.push_back({S.entityId++,vec{r.x,H-1-r.y},rum});
+            }
+            S.B.push_back({S.entityId++,r,rum});
+        }
+    }
+    return S;
+}
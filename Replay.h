@@ -0,0 +1,147 @@
+#pragma once
+//Replays of arena games: every turn's full state with the raw stdout and stderr of both bots.
+//The arena records the last Replay_Turns turns of each game in a ring and only writes the games matching its
+//replay filter, one zlib compressed chunk per game in the chunked format of Samples.h.
+#include "Samples.h"
+using namespace std;
+
+constexpr char Replay_Magic[8]{'C','o','t','C','R','P','L','2'};
+constexpr int Replay_Turns{200};//A whole game
+
+enum game_outcome{NORMAL=0,TIMEOUT=1,CRASH=2,INVALID=3,EXEC_FAILURE=4,OVERLOAD=5,ARENA_ERROR=6};//How a game ended, for the first bot which failed
+constexpr int Outcomes{7};
+const array<string,Outcomes> Outcome2Str{"normal","timeout","crash","invalid","exec_failure","overload","arena_error"};
+
+inline bool Infrastructure_Failure(const game_outcome outcome)noexcept{//The arena's fault rather than the bot's
+    return outcome==EXEC_FAILURE || outcome==OVERLOAD || outcome==ARENA_ERROR;
+}
+
+struct replay_turn{
+    int turn;
+    state S;//Before the moves of the turn are simulated
+    array<string,N> output,error;//Raw stdout and stderr of both bots during the turn
+};
+
+struct replay{
+    unsigned long long seed;
+    int stratum,winner;//Winner in game order, -1 for a draw
+    game_outcome outcome;
+    array<string,N> names;//In game order, player i owns the ships with owner i
+    state final;//State at the end of the game
+    vector<replay_turn> ring;
+    int head{0},count{0};//Oldest turn and number of recorded turns
+    inline void Clear()noexcept{//Keeps the ring's memory for the next game
+        head=count=0;
+        outcome=NORMAL;
+    }
+    inline replay_turn& Next(){//Slot for a new turn, overwriting the oldest one once the ring is full
+        if(count<ring.size()){//Reuse the slots of a previous game
+            return ring[(head+count++)%ring.size()];
+        }
+        if(ring.size()<Replay_Turns){
+            ring.emplace_back();
+            ++count;
+            return ring.back();
+        }
+        replay_turn &oldest=ring[head];
+        head=(head+1)%ring.size();
+        return oldest;
+    }
+    inline const replay_turn& operator[](const int i)const noexcept{//i-th oldest recorded turn
+        return ring[(head+i)%ring.size()];
+    }
+};
+
+inline void Encode(string &buf,const replay &R){
+    Put(buf,static_cast<int32_t>(R.seed));
+    Put(buf,static_cast<int32_t>(R.seed>>32));
+    for(const int a:{R.stratum,R.winner,static_cast<int>(R.outcome),R.count}){
+        Put(buf,a);
+    }
+    for(const string &name:R.names){
+        Put(buf,name);
+    }
+    Encode(buf,R.final);
+    for(int i=0;i<R.count;++i){
+        const replay_turn &T=R[i];
+        Put(buf,T.turn);
+        Encode(buf,T.S);
+        for(int j=0;j<N;++j){
+            Put(buf,T.output[j]);
+            Put(buf,T.error[j]);
+        }
+    }
+}
+
+inline void Decode(const char *&p,replay &R){
+    R.seed=static_cast<uint32_t>(Get(p));
+    R.seed|=static_cast<unsigned long long>(static_cast<uint32_t>(Get(p)))<<32;
+    R.stratum=Get(p);
+    R.winner=Get(p);
+    R.outcome=static_cast<game_outcome>(Get(p));
+    R.head=0;
+    R.count=Get(p);
+    for(string &name:R.names){
+        name=Get_String(p);
+    }
+    Decode(p,R.final);
+    R.ring.resize(R.count);
+    for(replay_turn &T:R.ring){
+        T.turn=Get(p);
+        Decode(p,T.S);
+        for(int j=0;j<N;++j){
+            T.output[j]=Get_String(p);
+            T.error[j]=Get_String(p);
+        }
+    }
+}
+
+struct replay_filter{//Which games are written to the replay file
+    bool loss{false},draw{false};//Loss of the first bot on the command line
+    array<bool,Outcomes> outcome{};
+    vector<unsigned long long> seeds;
+    inline bool Empty()const{
+        return !loss && !draw && none_of(outcome.begin(),outcome.end(),[](const bool b){return b;}) && seeds.empty();
+    }
+    inline bool Add(const string &category){//Returns false for an unknown category
+        if(category=="loss"){
+            loss=true;
+        }
+        else if(category=="draw"){
+            draw=true;
+        }
+        else if(category=="error"){//Any abnormal outcome
+            fill(outcome.begin()+1,outcome.end(),true);
+        }
+        else{
+            auto it=find(Outcome2Str.begin(),Outcome2Str.end(),category);
+            if(it==Outcome2Str.end()){
+                return false;
+            }
+            outcome[it-Outcome2Str.begin()]=true;
+        }
+        return true;
+    }
+    inline bool Match(const replay &R,const int winner)const{//winner in command line order
+        return (loss && winner==1) || (draw && winner==-1) || outcome[R.outcome] || find(seeds.begin(),seeds.end(),R.seed)!=seeds.end();
+    }
+};
+
+class replay_reader{
+    chunk_reader Reader;
+public:
+    inline replay_reader(const string &filename):Reader(filename,Replay_Magic){
+    }
+    inline bool good()const{
+        return Reader.good();
+    }
+    inline bool Next(replay &R){
+        const char *p;
+        int count;
+        if(!Reader.Next(p,count)){
+            return false;
+        }
+        Decode(p,R);
+        return true;
+    }
+};
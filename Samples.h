@@ -0,0 +1,286 @@
+#pragma once
+//Training samples recorded from arena games: (state, actions of both players, final outcome) tuples
+//File layout: an 8 byte magic followed by independent chunks, each one a chunk_header and zlib compressed samples.
+//Replay files (Replay.h) use the same layout with their own magic.
+//Chunks are appended by whichever arena thread fills its buffer first, so a file can be read while it is still being written.
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include "Referee.h"
+using namespace std;
+
+constexpr char Sample_Magic[8]{'C','o','t','C','S','M','P','1'};
+constexpr size_t Sample_Chunk_Size{1<<20};//Uncompressed bytes buffered per thread before a chunk is written
+
+struct sample{
+    int turn,winner;//Winner of the game the turn was taken from, -1 for a draw
+    state S;
+    array<strat,N> M;
+};
+
+struct chunk_header{
+    uint32_t samples,raw_bytes,compressed_bytes;
+};
+
+inline void Put(string &buf,const int32_t a){
+    buf.append(reinterpret_cast<const char*>(&a),sizeof(a));
+}
+
+inline int32_t Get(const char *&p){
+    int32_t a;
+    memcpy(&a,p,sizeof(a));
+    p+=sizeof(a);
+    return a;
+}
+
+inline void Put(string &buf,const string &str){
+    Put(buf,str.size());
+    buf.append(str);
+}
+
+inline string Get_String(const char *&p){
+    const int32_t size{Get(p)};
+    string str(p,size);
+    p+=size;
+    return str;
+}
+
+inline void Encode(string &buf,const state &S){
+    for(const int a:{S.entityId,static_cast<int>(S.S.size()),static_cast<int>(S.B.size()),static_cast<int>(S.M.size()),static_cast<int>(S.C.size())}){
+        Put(buf,a);
+    }
+    for(const ship &s:S.S){
+        for(const int a:{s.id,s.r.x,s.r.y,s.angle,s.speed,s.rum,s.owner,s.cd,s.mine_cd}){
+            Put(buf,a);
+        }
+    }
+    for(const barrel &b:S.B){
+        for(const int a:{b.id,b.r.x,b.r.y,b.rum}){
+            Put(buf,a);
+        }
+    }
+    for(const mine &m:S.M){
+        for(const int a:{m.id,m.r.x,m.r.y}){
+            Put(buf,a);
+        }
+    }
+    for(const cannonball &c:S.C){
+        for(const int a:{c.id,c.shooter_id,c.target.x,c.target.y,c.turns}){
+            Put(buf,a);
+        }
+    }
+}
+
+inline void Encode(string &buf,const sample &smp){
+    Put(buf,smp.turn);
+    Put(buf,smp.winner);
+    Encode(buf,smp.S);
+    for(const strat &M:smp.M){//A player which was already stopped has an empty strat
+        Put(buf,M.size());
+        for(const pair<const int,play> &mv:M){
+            for(const int a:{mv.first,static_cast<int>(mv.second.type),mv.second.target.x,mv.second.target.y}){
+                Put(buf,a);
+            }
+        }
+    }
+}
+
+inline void Decode(const char *&p,state &S){
+    S.clear();
+    S.entityId=Get(p);
+    S.S.resize(Get(p));
+    S.B.resize(Get(p));
+    S.M.resize(Get(p));
+    S.C.resize(Get(p));
+    for(ship &s:S.S){
+        for(int *a:{&s.id,&s.r.x,&s.r.y,&s.angle,&s.speed,&s.rum,&s.owner,&s.cd,&s.mine_cd}){
+            *a=Get(p);
+        }
+    }
+    for(barrel &b:S.B){
+        for(int *a:{&b.id,&b.r.x,&b.r.y,&b.rum}){
+            *a=Get(p);
+        }
+    }
+    for(mine &m:S.M){
+        for(int *a:{&m.id,&m.r.x,&m.r.y}){
+            *a=Get(p);
+        }
+    }
+    for(cannonball &c:S.C){
+        for(int *a:{&c.id,&c.shooter_id,&c.target.x,&c.target.y,&c.turns}){
+            *a=Get(p);
+        }
+    }
+}
+
+inline void Decode(const char *&p,sample &smp){
+    smp.turn=Get(p);
+    smp.winner=Get(p);
+    Decode(p,smp.S);
+    for(strat &M:smp.M){
+        M.clear();
+        const int moves{Get(p)};
+        for(int i=0;i<moves;++i){
+            const int id{Get(p)};
+            const move_type type{static_cast<move_type>(Get(p))};
+            const int x{Get(p)},y{Get(p)};
+            M[id]=play{type,vec{x,y}};
+        }
+    }
+}
+
+class chunk_writer{//Shared by all arena threads, each of which fills its own buffer
+    int fd;
+    mutex m;
+public:
+    inline chunk_writer(const string &filename,const char (&magic)[8]=Sample_Magic){
+        fd=open(filename.c_str(),O_WRONLY|O_CREAT|O_TRUNC,0644);
+        if(fd<0 || write(fd,magic,sizeof(magic))!=sizeof(magic)){
+            perror("opening chunked file");
+        }
+    }
+    inline bool good()const{
+        return fd>=0;
+    }
+    inline void Write_Chunk(const string &raw,const int samples){
+        uLongf compressed_bytes{compressBound(raw.size())};
+        string out(sizeof(chunk_header)+compressed_bytes,'\0');
+        if(compress2(reinterpret_cast<Bytef*>(&out[sizeof(chunk_header)]),&compressed_bytes,reinterpret_cast<const Bytef*>(raw.data()),raw.size(),Z_DEFAULT_COMPRESSION)!=Z_OK){
+            cerr << "Failed to compress a chunk of " << samples << " samples" << endl;
+            return;
+        }
+        const chunk_header header{static_cast<uint32_t>(samples),static_cast<uint32_t>(raw.size()),static_cast<uint32_t>(compressed_bytes)};
+        memcpy(&out[0],&header,sizeof(header));
+        out.resize(sizeof(chunk_header)+compressed_bytes);
+        lock_guard<mutex> lock(m);
+        if(write(fd,out.data(),out.size())!=static_cast<ssize_t>(out.size())){
+            perror("writing chunk");
+        }
+    }
+    inline ~chunk_writer(){
+        if(fd>=0){
+            close(fd);
+        }
+    }
+};
+
+struct sample_buffer{//Per thread buffer, so threads only contend for the file once per chunk
+    chunk_writer &W;
+    string raw;
+    int samples{0};
+    inline sample_buffer(chunk_writer &writer):W(writer){
+        raw.reserve(Sample_Chunk_Size+(1<<12));
+    }
+    inline void Push(const sample &smp){
+        Encode(raw,smp);
+        ++samples;
+        if(raw.size()>=Sample_Chunk_Size){
+            Flush();
+        }
+    }
+    inline void Flush(){
+        if(samples>0){
+            W.Write_Chunk(raw,samples);
+        }
+        raw.clear();
+        samples=0;
+    }
+    inline ~sample_buffer(){
+        Flush();
+    }
+};
+
+class chunk_reader{//Memory maps a chunked file and decompresses one chunk at a time
+    const char *data{nullptr};
+    size_t size{0},offset{sizeof(Sample_Magic)};
+    string chunk;
+public:
+    inline chunk_reader(const string &filename,const char (&magic)[8]=Sample_Magic){
+        const int fd{open(filename.c_str(),O_RDONLY)};
+        if(fd<0){
+            perror("opening chunked file");
+            return;
+        }
+        struct stat st;
+        if(fstat(fd,&st)==0 && st.st_size>=static_cast<off_t>(sizeof(magic))){
+            void *map{mmap(nullptr,st.st_size,PROT_READ,MAP_PRIVATE,fd,0)};
+            if(map!=MAP_FAILED){
+                data=static_cast<const char*>(map);
+                size=st.st_size;
+                madvise(map,size,MADV_SEQUENTIAL);
+            }
+        }
+        close(fd);//The mapping stays valid after closing the file
+        if(data==nullptr || memcmp(data,magic,sizeof(magic))!=0){
+            cerr << filename << " is not a " << string(magic,sizeof(magic)) << " file" << endl;
+            Unmap();
+        }
+    }
+    chunk_reader(const chunk_reader&)=delete;//Owns the mapping, a copy would unmap it twice
+    chunk_reader &operator=(const chunk_reader&)=delete;
+    inline bool good()const{
+        return data!=nullptr;
+    }
+    inline bool Next(const char *&p,int &count){//Points p to the decompressed content of the next chunk holding count entries
+        while(offset+sizeof(chunk_header)<=size){
+            chunk_header header;
+            memcpy(&header,data+offset,sizeof(header));
+            offset+=sizeof(header);
+            if(offset+header.compressed_bytes>size){
+                cerr << "Truncated chunk" << endl;
+                break;
+            }
+            chunk.resize(header.raw_bytes);
+            uLongf raw_bytes{header.raw_bytes};
+            const int err{uncompress(reinterpret_cast<Bytef*>(&chunk[0]),&raw_bytes,reinterpret_cast<const Bytef*>(data+offset),header.compressed_bytes)};
+            offset+=header.compressed_bytes;
+            if(err!=Z_OK || raw_bytes!=header.raw_bytes){
+                cerr << "Corrupt chunk" << endl;
+                break;
+            }
+            p=chunk.data();
+            count=header.samples;
+            if(count>0){
+                return true;
+            }
+        }
+        offset=size;
+        return false;
+    }
+    inline void Unmap(){
+        if(data!=nullptr){
+            munmap(const_cast<char*>(data),size);
+        }
+        data=nullptr;
+        size=0;
+    }
+    inline ~chunk_reader(){
+        Unmap();
+    }
+};
+
+class sample_reader{//Iterates the samples of a file without loading it whole
+    chunk_reader R;
+    const char *p{nullptr};
+    int remaining{0};//Samples left in the current chunk
+public:
+    inline sample_reader(const string &filename):R(filename){
+    }
+    inline bool good()const{
+        return R.good();
+    }
+    inline bool Next(sample &smp){
+        if(remaining==0 && !R.Next(p,remaining)){
+            return false;
+        }
+        Decode(p,smp);
+        --remaining;
+        return true;
+    }
+};
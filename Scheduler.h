@@ -0,0 +1,178 @@
+#pragma once
+//Work-stealing scheduler for arena games. Every worker thread owns a priority queue of tasks, steals from the
+//other workers when it runs dry and asks the task generator for a new batch when every queue is empty.
+//Each worker keeps its own stats, which are only merged when reporting, so finishing a task needs no atomics.
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <algorithm>
+using namespace std;
+
+template <class task> struct task_order{//Highest priority on top of the heap
+    inline bool operator()(const task &a,const task &b)const noexcept{
+        return a.priority<b.priority;
+    }
+};
+
+template <class task,class stats> class scheduler{
+    struct worker{
+        mutex m;//Guards Q and S, only contended by thieves and reports
+        vector<task> Q;//Heap ordered by task_order
+        stats S;
+        thread T;
+        atomic<bool> running{false},retire{false};
+    };
+    vector<unique_ptr<worker>> Workers;//Fixed number of slots so thieves can walk them without locking the vector
+    mutex gm,rm;//Generator and report mutexes
+    bool exhausted{false};
+    int next_worker{0};
+    const atomic<bool> &stop;//Set from a signal handler
+    inline bool Pop(worker &w,task &t){
+        lock_guard<mutex> lock(w.m);
+        if(w.Q.empty()){
+            return false;
+        }
+        pop_heap(w.Q.begin(),w.Q.end(),task_order<task>());
+        t=w.Q.back();
+        w.Q.pop_back();
+        return true;
+    }
+    inline bool Steal(const int idx,task &t){
+        for(int i=1;i<Workers.size();++i){
+            if(Pop(*Workers[(idx+i)%Workers.size()],t)){
+                return true;
+            }
+        }
+        return false;
+    }
+    inline bool Refill(worker &w,task &t){
+        vector<task> batch;
+        {
+            lock_guard<mutex> lock(gm);
+            if(exhausted){
+                return false;
+            }
+            exhausted=!Generate(batch);
+        }
+        if(batch.empty()){
+            return false;
+        }
+        {
+            lock_guard<mutex> lock(w.m);
+            for(const task &b:batch){
+                w.Q.push_back(b);
+                push_heap(w.Q.begin(),w.Q.end(),task_order<task>());
+            }
+        }
+        return Pop(w,t);
+    }
+    inline bool Exhausted(){
+        lock_guard<mutex> lock(gm);
+        return exhausted;
+    }
+    void Work(const int idx){
+        worker &w=*Workers[idx];
+        while(!stop && !w.retire){
+            task t;
+            if(!Pop(w,t) && !Steal(idx,t) && !Refill(w,t)){
+                if(Exhausted() && Active_Tasks()==0){
+                    break;
+                }
+                this_thread::sleep_for(chrono::milliseconds(1));//Others are still playing and may submit retries
+                continue;
+            }
+            const stats delta{Run(t)};
+            {
+                lock_guard<mutex> lock(w.m);
+                w.S+=delta;
+            }
+            if(Report){
+                lock_guard<mutex> lock(rm);
+                Report(Totals());
+            }
+        }
+        w.running=false;
+    }
+public:
+    function<bool(vector<task>&)> Generate;//Appends a batch of tasks, returns false once there will be no more
+    function<stats(const task&)> Run;//Plays a task, returns what it adds to the stats
+    function<void(const stats&)> Report;//Called with the merged stats after every task
+    inline scheduler(const int max_threads,const atomic<bool> &stop_flag):stop(stop_flag){
+        for(int i=0;i<max_threads;++i){
+            Workers.emplace_back(new worker);
+        }
+    }
+    inline int Threads()const noexcept{//Workers running and not retiring
+        return count_if(Workers.begin(),Workers.end(),[](const unique_ptr<worker> &w){return w->running && !w->retire;});
+    }
+    inline int Active_Tasks(){//Tasks waiting in a queue
+        int n{0};
+        for(unique_ptr<worker> &w:Workers){
+            lock_guard<mutex> lock(w->m);
+            n+=w->Q.size();
+        }
+        return n;
+    }
+    inline void Submit(const task &t){
+        int idx;
+        {
+            lock_guard<mutex> lock(gm);
+            idx=next_worker;
+            next_worker=(next_worker+1)%Workers.size();
+        }
+        worker &w=*Workers[idx];
+        lock_guard<mutex> lock(w.m);
+        w.Q.push_back(t);
+        push_heap(w.Q.begin(),w.Q.end(),task_order<task>());
+    }
+    void Resize(const int n){//Retired workers finish their current task, their queued tasks get stolen
+        int running{0};
+        for(int i=0;i<Workers.size();++i){
+            worker &w=*Workers[i];
+            if(w.running && !w.retire){
+                if(running<n){
+                    ++running;
+                }
+                else{
+                    w.retire=true;
+                }
+            }
+        }
+        for(int i=0;i<Workers.size() && running<n;++i){
+            worker &w=*Workers[i];
+            if(!w.running){
+                if(w.T.joinable()){
+                    w.T.join();
+                }
+                w.retire=false;
+                w.running=true;
+                w.T=thread(&scheduler::Work,this,i);
+                ++running;
+            }
+        }
+    }
+    inline bool Finished()const noexcept{
+        return none_of(Workers.begin(),Workers.end(),[](const unique_ptr<worker> &w){return w->running.load();});
+    }
+    inline stats Totals(){
+        stats total;
+        for(unique_ptr<worker> &w:Workers){
+            lock_guard<mutex> lock(w->m);
+            total+=w->S;
+        }
+        return total;
+    }
+    inline ~scheduler(){
+        for(unique_ptr<worker> &w:Workers){
+            w->retire=true;
+        }
+        for(unique_ptr<worker> &w:Workers){
+            if(w->T.joinable()){
+                w->T.join();
+            }
+        }
+    }
+};
@@ -0,0 +1,67 @@
+#pragma once
+//Map strata for adaptive map selection. Maps are grouped by ship count, mine count and barrel count, game pairs
+//(same map, both sides) are drawn more often from the strata where their outcome varies, and the win rate is
+//estimated per stratum and weighted by how likely the stratum is in the natural map distribution so it stays unbiased.
+#include <array>
+#include <cmath>
+#include <utility>
+using namespace std;
+
+struct map_stratum{//Ranges are inclusive
+    int ships,min_mines,max_mines,min_barrels,max_barrels;
+    inline double weight()const noexcept{//Probability under Play_Round's 1-3 ships, 5-10 mines and 10-26 barrels
+        return (1.0/3)*((max_mines-min_mines+1)/6.0)*((max_barrels-min_barrels+1)/17.0);
+    }
+};
+
+constexpr int Strata{12};
+constexpr int Min_Stratum_Pairs{4};//Pairs played in a stratum before its own variance is trusted
+constexpr double Min_Stratum_Sigma{0.05};//Keeps strata which looked lopsided so far from starving
+
+const array<map_stratum,Strata> Stratum{{
+    {1,5,7,10,17},{1,5,7,18,26},{1,8,10,10,17},{1,8,10,18,26},
+    {2,5,7,10,17},{2,5,7,18,26},{2,8,10,10,17},{2,8,10,18,26},
+    {3,5,7,10,17},{3,5,7,18,26},{3,8,10,10,17},{3,8,10,18,26}
+}};
+
+struct stratum_stats{//Scores of game pairs, 1 if the first bot won both games, 0.5 if the pair was split
+    int n{0};
+    double sum{0},sum2{0};
+    inline void Add(const double score)noexcept{
+        ++n;
+        sum+=score;
+        sum2+=score*score;
+    }
+    inline void operator+=(const stratum_stats &a)noexcept{
+        n+=a.n;
+        sum+=a.sum;
+        sum2+=a.sum2;
+    }
+    inline double mean()const noexcept{
+        return sum/n;
+    }
+    inline double variance()const noexcept{//Unbiased sample variance
+        return n<2?0.25:max(0.0,(sum2-sum*sum/n)/(n-1));
+    }
+};
+
+inline double Neyman_Weight(const int h,const stratum_stats &s)noexcept{//Share of new pairs the stratum should get
+    const double sigma{s.n<Min_Stratum_Pairs?0.5:max(Min_Stratum_Sigma,sqrt(s.variance()))};
+    return Stratum[h].weight()*sigma;
+}
+
+inline pair<double,double> Stratified_Estimate(const array<stratum_stats,Strata> &S)noexcept{//Win rate and its standard error
+    double p{0},var{0},w{0};
+    for(int h=0;h<Strata;++h){
+        if(S[h].n>0){
+            const double wh{Stratum[h].weight()};
+            p+=wh*S[h].mean();
+            var+=wh*wh*S[h].variance()/S[h].n;
+            w+=wh;
+        }
+    }
+    if(w==0){
+        return {0.5,0.5};
+    }
+    return {p/w,sqrt(var)/w};//Renormalised until every stratum has been played
+}
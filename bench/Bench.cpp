@@ -0,0 +1,267 @@
+//Referee throughput benchmarks. Results are printed as tab separated "name value unit" lines,
+//followed by the baseline value and the relative change when a baseline file from a previous run is given.
+//Bench exits with an error when a result regressed, so scripts can check its status.
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <limits>
+#include "../Referee.h"
+using namespace std;
+using namespace std::chrono;
+
+constexpr double Min_Sample_Time{0.2};//Seconds spent per timing sample
+constexpr int Samples{5};//The median sample is reported
+constexpr double Regression_Threshold{0.1};//Relative change above which a result is flagged
+constexpr int Max_Redraws{100};//Times the moves of a turn which sank a ship are redrawn before the corpus game is abandoned
+
+typedef board<60,48,4,12,0> crowded_board;//48 ships, collisions found with the ship_grid
+typedef board<60,48,4,12,numeric_limits<int>::max()> crowded_board_pairs;//Same rules testing every pair of ships
+
+struct result{
+    string name;
+    double value;
+    string unit;
+};
+
+template <class Board=default_board> struct position{//A state and the moves every player makes from it
+    state S;
+    array<strat,Board::N> M;
+    array<string,Board::N> M_str;
+};
+
+volatile int Sink;//Keeps the compiler from optimising the benchmarked calls away
+
+template <class F> double Time_Per_Op(F f){//f performs some operations and returns how many
+    array<double,Samples> T;
+    for(double &t:T){
+        long long ops{0};
+        const time_point<steady_clock> Start{steady_clock::now()};
+        double elapsed{0};
+        while(elapsed<Min_Sample_Time){
+            ops+=f();
+            elapsed=static_cast<duration<double>>(steady_clock::now()-Start).count();
+        }
+        t=elapsed*1e9/ops;
+    }
+    nth_element(T.begin(),T.begin()+Samples/2,T.end());
+    return T[Samples/2];
+}
+
+template <class Board> inline string Random_Move(default_random_engine &generator,const ship &s){
+    uniform_int_distribution<int> Type_Distrib(0,7),Offset_Distrib(-6,6),X_Distrib(0,Board::W-1),Y_Distrib(0,Board::H-1);
+    const move_type type{static_cast<move_type>(Type_Distrib(generator))};
+    stringstream ss;
+    if(type==FIRE){
+        ss << play{FIRE,vec{s.r.x+Offset_Distrib(generator),s.r.y+Offset_Distrib(generator)}};
+    }
+    else if(type==MOVE){
+        ss << "MOVE " << vec{X_Distrib(generator),Y_Distrib(generator)};
+    }
+    else{
+        ss << play{type};
+    }
+    return ss.str();
+}
+
+template <class Board> inline void Random_Moves(default_random_engine &generator,position<Board> &P){
+    for(int i=0;i<Board::N;++i){
+        P.M_str[i].clear();
+        for(const ship &s:P.S.S){
+            if(s.owner==i){
+                P.M_str[i]+=Random_Move<Board>(generator,s)+"\n";
+            }
+        }
+        P.M[i]=StringToStrat<Board>(P.S,i,"bench",P.M_str[i]);
+    }
+}
+
+template <class Board> inline bool No_Losses(const state &S,const int shipsPerPlayer)noexcept{//Every ship is still afloat, so the corpus matches its label
+    return S.S.size()==Board::N*shipsPerPlayer;
+}
+
+template <class Board=default_board> vector<position<Board>> Corpus(const int shipsPerPlayer,const int turns){//Seeded positions reached after playing random moves for some turns without sinking a ship, so the corpus has the ship count in its name
+    constexpr int Scale{Board::W*Board::H/(W*H)};//Same density of mines and barrels as the game
+    vector<position<Board>> C;
+    default_random_engine generator(1000*shipsPerPlayer+turns);
+    while(C.size()<16){
+        position<Board> P;
+        P.S=Generate_Map<Board>(generator,shipsPerPlayer,10*Scale,20*Scale);
+        Random_Moves(generator,P);
+        int turn{0};
+        for(int redraws=0;turn<turns && redraws<Max_Redraws;){
+            for(ship &s:P.S.S){//Few ships survive 80 turns of random moves, and rum doesn't change the cost of Simulate
+                s.rum=100;
+            }
+            state S{P.S};
+            Simulate<false,Board>(S,P.M);
+            if(No_Losses<Board>(S,shipsPerPlayer)){
+                P.S=S;
+                ++turn;
+                redraws=0;
+            }
+            else{
+                ++redraws;
+            }
+            Random_Moves(generator,P);
+        }
+        if(turn==turns){
+            C.push_back(P);
+        }
+    }
+    return C;
+}
+
+template <class Board> double Simulate_Time(const vector<position<Board>> &C){
+    return Time_Per_Op([&](){
+        for(const position<Board> &P:C){
+            state S=P.S;
+            Simulate<false,Board>(S,P.M);
+            Sink=S.entityId;
+        }
+        return C.size();
+    });
+}
+
+double Games_Per_Second(const int games){//Full arena games between two bots which only ever WAIT
+    const int threads{max(1,static_cast<int>(thread::hardware_concurrency()))};
+    const string cmd{"./Arena bench/EchoBot bench/EchoBot "+to_string(threads)+" --games "+to_string(games)+" >/dev/null 2>&1"};
+    const time_point<steady_clock> Start{steady_clock::now()};
+    if(system(cmd.c_str())!=0){
+        cerr << "Failed to run " << cmd << endl;
+        return 0;
+    }
+    return games/static_cast<duration<double>>(steady_clock::now()-Start).count();
+}
+
+map<string,double> Load_Baseline(const string &filename){
+    map<string,double> Baseline;
+    ifstream in(filename);
+    string line;
+    while(getline(in,line)){
+        stringstream ss(line);
+        string name;
+        double value;
+        if(ss >> name >> value){
+            Baseline[name]=value;
+        }
+    }
+    return Baseline;
+}
+
+int main(int argc,char **argv){
+    string Baseline_File,Output_File,New_Baseline_File;
+    int games{100};
+    for(int i=1;i<argc;++i){
+        const string arg{argv[i]};
+        if(arg=="--baseline" && i+1<argc){
+            Baseline_File=argv[++i];
+        }
+        else if(arg=="--games" && i+1<argc){//0 skips the end-to-end benchmark
+            games=max(0,atoi(argv[++i]));
+        }
+        else if(arg=="--output" && i+1<argc){//Copy of what is printed
+            Output_File=argv[++i];
+        }
+        else if(arg=="--write-baseline" && i+1<argc){//Results of this run become the baseline of the next ones
+            New_Baseline_File=argv[++i];
+        }
+        else{
+            cerr << "Usage: Bench [--baseline file] [--games n] [--output file] [--write-baseline file]" << endl;
+            return 1;
+        }
+    }
+    vector<result> Results;
+    vector<position<>> All;
+    const array<string,3> Phase_Name{"early","mid","late"};
+    const array<int,3> Phase_Turns{0,40,80};
+    for(int ships=1;ships<=3;++ships){
+        for(int phase=0;phase<3;++phase){
+            const vector<position<>> C{Corpus(ships,Phase_Turns[phase])};
+            All.insert(All.end(),C.begin(),C.end());
+            Results.push_back(result{"Simulate/"+Phase_Name[phase]+"/"+to_string(ships)+"v"+to_string(ships),Simulate_Time(C),"ns/op"});
+        }
+    }
+    for(int phase=0;phase<3;++phase){//Scaling of the collision passes with the number of ships
+        const vector<position<crowded_board>> C{Corpus<crowded_board>(crowded_board::Max_Ships,Phase_Turns[phase])};
+        vector<position<crowded_board_pairs>> C_Pairs;
+        for(const position<crowded_board> &P:C){
+            C_Pairs.push_back(position<crowded_board_pairs>{P.S,P.M,P.M_str});
+        }
+        const string name{"Simulate/"+Phase_Name[phase]+"/"+to_string(crowded_board::Max_Ships)+"x"+to_string(crowded_board::N)};
+        Results.push_back(result{name,Simulate_Time(C),"ns/op"});
+        Results.push_back(result{name+"/pairs",Simulate_Time(C_Pairs),"ns/op"});
+    }
+    Results.push_back(result{"StringToStrat",Time_Per_Op([&](){
+        for(const position<> &P:All){
+            Sink=StringToStrat(P.S,0,"bench",P.M_str[0]).size();
+        }
+        return All.size();
+    }),"ns/op"});
+    Results.push_back(result{"Turn_Inputs",Time_Per_Op([&](){
+        for(const position<> &P:All){
+            Sink=Turn_Inputs(P.S,0).size();
+        }
+        return All.size();
+    }),"ns/op"});
+    vector<pair<vec,vec>> Pairs;
+    default_random_engine generator(0);
+    uniform_int_distribution<int> X_Distrib(0,W-1),Y_Distrib(0,H-1);
+    for(int i=0;i<1024;++i){
+        Pairs.push_back({vec{X_Distrib(generator),Y_Distrib(generator)},vec{X_Distrib(generator),Y_Distrib(generator)}});
+    }
+    Results.push_back(result{"Dist",Time_Per_Op([&](){
+        int d{0};
+        for(const pair<vec,vec> &p:Pairs){
+            d+=Dist(p.first,p.second);
+        }
+        Sink=d;
+        return Pairs.size();
+    }),"ns/op"});
+    Results.push_back(result{"Basic_Move",Time_Per_Op([&](){
+        int ops{0};
+        for(const position<> &P:All){
+            for(const ship &s:P.S.S){
+                const pair<vec,vec> &p=Pairs[ops%Pairs.size()];
+                Sink=Basic_Move(P.S,s,p.first).type;
+                ++ops;
+            }
+        }
+        return ops;
+    }),"ns/op"});
+    if(games>0){
+        Results.push_back(result{"Games",Games_Per_Second(games),"games/s"});
+    }
+    const map<string,double> Baseline{Load_Baseline(Baseline_File)};
+    if(!Baseline_File.empty() && Baseline.empty()){
+        cerr << "No baseline in " << Baseline_File << ", create one with --write-baseline" << endl;
+    }
+    ofstream Output,New_Baseline;
+    if(!Output_File.empty()){
+        Output.open(Output_File);
+    }
+    if(!New_Baseline_File.empty()){
+        New_Baseline.open(New_Baseline_File);
+    }
+    int regressions{0};
+    for(const result &r:Results){
+        stringstream line;
+        line << r.name << "\t" << setprecision(6) << r.value << "\t" << r.unit;
+        New_Baseline << line.str() << endl;
+        auto it=Baseline.find(r.name);
+        if(it!=Baseline.end() && it->second>0){
+            const double change{r.value/it->second-1};
+            const bool slower{r.unit=="games/s"?change<-Regression_Threshold:change>Regression_Threshold};
+            line << "\t" << it->second << "\t" << showpos << setprecision(3) << 100*change << "%" << noshowpos << (slower?"\tREGRESSION":"");
+            regressions+=slower;
+        }
+        cout << line.str() << endl;
+        Output << line.str() << endl;
+    }
+    if(regressions>0){
+        cerr << regressions << " benchmarks are more than " << 100*Regression_Threshold << "% slower than the baseline" << endl;
+    }
+    return regressions>0?1:0;
+}
@@ -0,0 +1,18 @@
+//Trivial bot for the end-to-end benchmark: reads its inputs and answers WAIT for every ship
+#include <iostream>
+#include <string>
+using namespace std;
+
+int main(){
+    int myShipCount,entityCount;
+    while(cin >> myShipCount >> entityCount){
+        for(int i=0;i<entityCount;++i){
+            int id,x,y,arg1,arg2,arg3,arg4;
+            string type;
+            cin >> id >> type >> x >> y >> arg1 >> arg2 >> arg3 >> arg4;
+        }
+        for(int i=0;i<myShipCount;++i){
+            cout << "WAIT" << endl;
+        }
+    }
+}
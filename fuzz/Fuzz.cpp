@@ -0,0 +1,293 @@
+//Differential fuzzer: plays random moves from random states with Simulate from Referee.h and with the frozen
+//reference simulator, and reports the first field on which they disagree. Case i is fully determined by seed+i.
+//Every case is simulated with both collision passes, and a crowded 4 player variant checks the ship_grid pass against testing every pair.
+#include <iostream>
+#include <chrono>
+#include <limits>
+#include <omp.h>
+#include "Reference.h"
+using namespace std;
+using namespace std::chrono;
+
+constexpr int Turns_Per_Case{8};
+constexpr int Crowded_Period{8};//One case in Crowded_Period also plays the crowded variant, which costs about as much as 6 regular cases
+
+typedef board<W,H,N,Max_Ships,0> indexed_board;//The game with every collision found through the ship_grid
+typedef board<36,32,4,12,0> crowded_board;//Small enough for ships to collide all the time, large enough for Generate_Map
+typedef board<36,32,4,12,numeric_limits<int>::max()> crowded_board_pairs;//Same rules testing every pair of ships
+
+inline bool Overlaps(const state &S,const ship &a)noexcept{
+    return any_of(S.S.begin(),S.S.end(),[&](const ship &b){return b.IsBoat(a.r) || b.IsBoat(a.front()) || b.IsBoat(a.back()) || a.IsBoat(b.front()) || a.IsBoat(b.back());});
+}
+
+template <class Board=default_board> inline vec Random_Cell(default_random_engine &generator){
+    constexpr int W{Board::W},H{Board::H};
+    uniform_int_distribution<int> X_Distrib(0,W-1),Y_Distrib(0,H-1),Border_Distrib(0,7);
+    vec r{X_Distrib(generator),Y_Distrib(generator)};
+    switch(Border_Distrib(generator)){//Ships and entities on the edges of the map are the interesting cases
+        case 0: r.x=0; break;
+        case 1: r.x=W-1; break;
+        case 2: r.y=0; break;
+        case 3: r.y=H-1; break;
+    }
+    return r;
+}
+
+template <class Board> inline void Add_Ship(state &S,default_random_engine &generator,const int owner){
+    uniform_int_distribution<int> Angle_Distrib(0,5),Speed_Distrib(0,2),Rum_Distrib(1,100),Cd_Distrib(0,1),Mine_Cd_Distrib(0,4);
+    for(int attempt=0;attempt<20;++attempt){
+        const ship s{S.entityId,Random_Cell<Board>(generator),Angle_Distrib(generator),Speed_Distrib(generator),Rum_Distrib(generator),owner,Cd_Distrib(generator),Mine_Cd_Distrib(generator)};
+        if(!Overlaps(S,s)){
+            S.S.push_back(s);
+            ++S.entityId;
+            return;
+        }
+    }
+}
+
+template <class Board> inline void Add_Head_On(state &S,default_random_engine &generator){//Two ships of different players sailing into each other
+    uniform_int_distribution<int> Angle_Distrib(0,5),Speed_Distrib(1,2),Gap_Distrib(2,5),Rum_Distrib(1,100);
+    ship a{S.entityId,Random_Cell<Board>(generator),Angle_Distrib(generator),Speed_Distrib(generator),Rum_Distrib(generator),0,0,0};
+    ship b{S.entityId+1,a.r,Opposite_Angle(a.angle),Speed_Distrib(generator),Rum_Distrib(generator),1,0,0};
+    for(int gap=Gap_Distrib(generator);gap>0;--gap){
+        b.r=Neighbour(b.r,a.angle);
+    }
+    if(Valid<Board>(a.r) && Valid<Board>(b.r) && !Overlaps(S,a)){
+        S.S.push_back(a);
+        if(!Overlaps(S,b)){
+            S.S.push_back(b);
+            S.entityId+=2;
+        }
+        else{
+            S.S.pop_back();
+        }
+    }
+}
+
+template <class Board=default_board> state Random_State(default_random_engine &generator){
+    constexpr int Scale{Board::W*Board::H/(W*H)};//Same density of entities as the game
+    uniform_int_distribution<int> Ship_Count(1,Board::Max_Ships),Mine_Count(0,12*Scale),Barrel_Count(0,16*Scale),Ball_Count(0,6*Scale),Rum_Distrib(10,20),Turns_Distrib(1,4),Coin(0,1);
+    state S;
+    S.entityId=0;
+    if(Coin(generator)){
+        Add_Head_On<Board>(S,generator);
+    }
+    for(int owner=0;owner<Board::N;++owner){
+        for(int i=Ship_Count(generator);i>0;--i){
+            Add_Ship<Board>(S,generator,owner);
+        }
+    }
+    for(int i=Mine_Count(generator);i>0;--i){
+        vec r{Random_Cell<Board>(generator)};
+        if(Coin(generator) && !S.S.empty()){//Where the bow or stern of a ship ends up if it rotates
+            const ship &s=S.S[uniform_int_distribution<int>(0,S.S.size()-1)(generator)];
+            r=Neighbour(s.r,(s.angle+uniform_int_distribution<int>(1,5)(generator))%6);
+        }
+        if(Valid<Board>(r) && reference::Free(S,r)){
+            S.M.push_back(mine{S.entityId++,r});
+        }
+    }
+    for(int i=Barrel_Count(generator);i>0;--i){
+        const vec r{Random_Cell<Board>(generator)};
+        if(reference::Free(S,r)){
+            S.B.push_back(barrel{S.entityId++,r,Rum_Distrib(generator)});
+        }
+    }
+    for(int i=S.S.empty()?0:Ball_Count(generator);i>0;--i){
+        vec target{Random_Cell<Board>(generator)};
+        if(Coin(generator) && !S.B.empty()){//Cannonball landing on a barrel
+            target=S.B[uniform_int_distribution<int>(0,S.B.size()-1)(generator)].r;
+        }
+        else if(Coin(generator) && !S.M.empty()){
+            target=S.M[uniform_int_distribution<int>(0,S.M.size()-1)(generator)].r;
+        }
+        const int shooter{S.S[uniform_int_distribution<int>(0,S.S.size()-1)(generator)].id};
+        S.C.push_back(cannonball{S.entityId++,shooter,target,Turns_Distrib(generator)});
+    }
+    return S;
+}
+
+template <class Board=default_board> array<strat,Board::N> Random_Moves(default_random_engine &generator,const state &S){
+    uniform_int_distribution<int> Type_Distrib(FIRE,WAIT),Offset_Distrib(-12,12);
+    array<strat,Board::N> M;
+    for(const ship &s:S.S){
+        const move_type type{static_cast<move_type>(Type_Distrib(generator))};
+        M[s.owner][s.id]=play{type,type==FIRE?s.front()+vec{Offset_Distrib(generator),Offset_Distrib(generator)}:vec{0,0}};
+    }
+    return M;
+}
+
+inline bool operator==(const ship &a,const ship &b)noexcept{
+    return a.id==b.id && a.r==b.r && a.angle==b.angle && a.speed==b.speed && a.rum==b.rum && a.owner==b.owner && a.cd==b.cd && a.mine_cd==b.mine_cd;
+}
+
+inline bool operator==(const barrel &a,const barrel &b)noexcept{
+    return a.id==b.id && a.r==b.r && a.rum==b.rum;
+}
+
+inline bool operator==(const mine &a,const mine &b)noexcept{
+    return a.id==b.id && a.r==b.r;
+}
+
+inline bool operator==(const cannonball &a,const cannonball &b)noexcept{
+    return a.id==b.id && a.shooter_id==b.shooter_id && a.target==b.target && a.turns==b.turns;
+}
+
+inline bool operator==(const state &a,const state &b)noexcept{//Cheap check, Diverges explains the difference
+    return a.entityId==b.entityId && a.S==b.S && a.B==b.B && a.M==b.M && a.C==b.C;
+}
+
+template <class T> inline bool Diverges(ostream &os,const string &field,const T &a,const T &b){
+    if(a==b){
+        return false;
+    }
+    os << field << ": " << a << " (engine) != " << b << " (reference)";
+    return true;
+}
+
+inline bool Diverges(ostream &os,const string &name,const ship &a,const ship &b){
+    return Diverges(os,name+".id",a.id,b.id) || Diverges(os,name+".r",a.r,b.r) || Diverges(os,name+".angle",a.angle,b.angle) || Diverges(os,name+".speed",a.speed,b.speed)
+        || Diverges(os,name+".rum",a.rum,b.rum) || Diverges(os,name+".owner",a.owner,b.owner) || Diverges(os,name+".cd",a.cd,b.cd) || Diverges(os,name+".mine_cd",a.mine_cd,b.mine_cd);
+}
+
+inline bool Diverges(ostream &os,const string &name,const barrel &a,const barrel &b){
+    return Diverges(os,name+".id",a.id,b.id) || Diverges(os,name+".r",a.r,b.r) || Diverges(os,name+".rum",a.rum,b.rum);
+}
+
+inline bool Diverges(ostream &os,const string &name,const mine &a,const mine &b){
+    return Diverges(os,name+".id",a.id,b.id) || Diverges(os,name+".r",a.r,b.r);
+}
+
+inline bool Diverges(ostream &os,const string &name,const cannonball &a,const cannonball &b){
+    return Diverges(os,name+".id",a.id,b.id) || Diverges(os,name+".shooter_id",a.shooter_id,b.shooter_id) || Diverges(os,name+".target",a.target,b.target) || Diverges(os,name+".turns",a.turns,b.turns);
+}
+
+template <class T> inline bool Diverges(ostream &os,const string &name,const vector<T> &a,const vector<T> &b){
+    for(int i=0;i<min(a.size(),b.size());++i){
+        if(Diverges(os,name+"["+to_string(i)+"]",a[i],b[i])){
+            return true;
+        }
+    }
+    return Diverges(os,name+".size()",a.size(),b.size());
+}
+
+inline bool Diverges(ostream &os,const state &a,const state &b){
+    return Diverges(os,"S",a.S,b.S) || Diverges(os,"B",a.B,b.B) || Diverges(os,"M",a.M,b.M) || Diverges(os,"C",a.C,b.C) || Diverges(os,"entityId",a.entityId,b.entityId);
+}
+
+template <size_t players> void Print(ostream &os,const state &S,const array<strat,players> &M){
+    os << "entityId " << S.entityId << endl;
+    for(const ship &s:S.S){
+        os << "ship " << s.id << " r " << s.r << " angle " << s.angle << " speed " << s.speed << " rum " << s.rum << " owner " << s.owner << " cd " << s.cd << " mine_cd " << s.mine_cd << " plays " << M[s.owner].at(s.id) << endl;
+    }
+    for(const barrel &b:S.B){
+        os << "barrel " << b.id << " r " << b.r << " rum " << b.rum << endl;
+    }
+    for(const mine &m:S.M){
+        os << "mine " << m.id << " r " << m.r << endl;
+    }
+    for(const cannonball &c:S.C){
+        os << "cannonball " << c.id << " shooter " << c.shooter_id << " target " << c.target << " turns " << c.turns << endl;
+    }
+}
+
+template <size_t players> string Divergence(const state &Engine,const state &Reference,const string &engine,const int turn,const unsigned long long seed,const state &S,const array<strat,players> &M){
+    stringstream ss;
+    Diverges(ss,Engine,Reference);
+    ss << " with " << engine << " on turn " << turn << " of case " << seed << " from" << endl;
+    Print(ss,S,M);
+    return ss.str();
+}
+
+inline int Players_Alive(const state &S,const int players)noexcept{
+    int alive{0};
+    for(int i=0;i<players;++i){
+        alive+=Player_Alive(S,i);
+    }
+    return alive;
+}
+
+string Run_Case(const unsigned long long seed){//Empty if the engine agreed with the reference on every turn
+    default_random_engine generator(seed);
+    state S{Random_State(generator)};
+    for(int turn=0;turn<Turns_Per_Case && Player_Alive(S,0) && Player_Alive(S,1);++turn){
+        const array<strat,N> M{Random_Moves(generator,S)};
+        state Engine{S},Indexed{S},Reference{S};
+        Simulate<false>(Engine,M);
+        Simulate<false,indexed_board>(Indexed,M);
+        reference::Simulate(Reference,M);
+        if(!(Engine==Reference)){
+            return Divergence(Engine,Reference,"Simulate",turn,seed,S,M);
+        }
+        if(!(Indexed==Reference)){
+            return Divergence(Indexed,Reference,"the ship_grid collision pass",turn,seed,S,M);
+        }
+        S=Reference;
+    }
+    if(seed%Crowded_Period!=0){
+        return "";
+    }
+    generator.seed(seed);//The crowded variant has no reference, the ship_grid pass is checked against testing every pair instead
+    S=Random_State<crowded_board>(generator);
+    for(int turn=0;turn<Turns_Per_Case && Players_Alive(S,crowded_board::N)>1;++turn){
+        const array<strat,crowded_board::N> M{Random_Moves<crowded_board>(generator,S)};
+        state Indexed{S},Pairs{S};
+        Simulate<false,crowded_board>(Indexed,M);
+        Simulate<false,crowded_board_pairs>(Pairs,M);
+        if(!(Indexed==Pairs)){
+            return Divergence(Indexed,Pairs,"the crowded variant (reference is testing every pair)",turn,seed,S,M);
+        }
+        S=Pairs;
+    }
+    return "";
+}
+
+int main(int argc,char **argv){
+    unsigned long long seed{0},cases{1000000};
+    int threads{omp_get_num_procs()};
+    for(int i=1;i<argc;++i){
+        const string arg{argv[i]};
+        if(arg=="--seed" && i+1<argc){
+            seed=stoull(argv[++i]);
+        }
+        else if(arg=="--cases" && i+1<argc){
+            cases=stoull(argv[++i]);
+        }
+        else if(arg=="--threads" && i+1<argc){
+            threads=max(1,atoi(argv[++i]));
+        }
+        else{
+            cerr << "Usage: Fuzz [--seed s] [--cases n] [--threads t]" << endl;
+            return 1;
+        }
+    }
+    const time_point<steady_clock> Start{steady_clock::now()};
+    unsigned long long first_failure{numeric_limits<unsigned long long>::max()};
+    string report;
+    #pragma omp parallel for num_threads(threads) schedule(dynamic,1024)
+    for(unsigned long long i=0;i<cases;++i){
+        unsigned long long failure;
+        #pragma omp atomic read
+        failure=first_failure;
+        if(i>failure){//Only the lowest failing case is reported
+            continue;
+        }
+        const string divergence{Run_Case(seed+i)};
+        if(!divergence.empty()){
+            #pragma omp critical
+            if(i<first_failure){
+                #pragma omp atomic write
+                first_failure=i;
+                report=divergence;
+            }
+        }
+    }
+    const double elapsed{static_cast<duration<double>>(steady_clock::now()-Start).count()};
+    cerr << cases << " cases in " << elapsed << "s, " << cases/elapsed << " cases/s on " << threads << " threads" << endl;
+    if(!report.empty()){
+        cout << "Divergence in " << report;
+        return 1;
+    }
+    cout << "No divergence" << endl;
+    return 0;
+}
@@ -0,0 +1,246 @@
+#pragma once
+//Frozen copy of the simulator as it was before any optimisation, the fuzzer checks Simulate from Referee.h against it.
+//Do not change this file unless the game rules themselves change.
+//Only the plain data structs come from Referee.h, the geometry helpers are copied too so that optimising them cannot change both engines alike.
+#include "../Referee.h"
+using namespace std;
+
+namespace reference{
+
+constexpr int Width{23},Height{21};//Board of the game on CodinGame
+
+constexpr array<vec,6> Steps_Even{vec{1,0},vec{0,-1},vec{-1,-1},vec{-1,0},vec{-1,1},vec{0,1}};
+constexpr array<vec,6> Steps_Odd{vec{1,0},vec{1,-1},vec{0,-1},vec{-1,0},vec{0,1},vec{1,1}};
+constexpr array<array<vec,6>,2> Steps{Steps_Even,Steps_Odd};
+
+inline bool Inside(const vec &r)noexcept{
+    return r.x<Width && r.y<Height && r.x>=0 && r.y>=0;
+}
+
+inline vec Step(const vec &r,const int angle)noexcept{//Neighbouring cell
+    const bool odd{r.y%2!=0};
+    return r+Steps[odd][angle];
+}
+
+inline int Reverse(const int angle)noexcept{
+    return (angle+3)%6;
+}
+
+inline int Distance(const vec &a,const vec &b)noexcept{//Through cube coordinates
+    const int ax{a.x-(a.y-(a.y&1))/2},bx{b.x-(b.y-(b.y&1))/2};
+    return max({abs(ax-bx),abs(ax+a.y-bx-b.y),abs(a.y-b.y)});
+}
+
+inline vec Bow(const ship &s)noexcept{
+    return Step(s.r,s.angle);
+}
+
+inline vec Stern(const ship &s)noexcept{
+    return Step(s.r,Reverse(s.angle));
+}
+
+inline bool Occupies(const ship &s,const vec &a)noexcept{
+    return a==s.r || a==Stern(s) || a==Bow(s);
+}
+
+inline void Ship_Blow(ship &s,const vec &hit)noexcept{
+    if(hit==s.r){
+        s.rum=max(0,s.rum-50);
+    }
+    else if(hit==Bow(s) || hit==Stern(s)){
+        s.rum=max(0,s.rum-25);
+    }
+}
+
+inline void Splash(ship &s,const vec &source)noexcept{
+    if(Distance(Stern(s),source)<=1 || Distance(s.r,source)<=1 || Distance(Bow(s),source)<=1){
+        s.rum-=10;
+    }
+}
+
+inline void Purge(state &S)noexcept{
+    S.C.erase(remove_if(S.C.begin(),S.C.end(),[](const cannonball &c){return c.turns<=0;}),S.C.end());
+    S.S.erase(remove_if(S.S.begin(),S.S.end(),[](const ship &s){return s.rum<=0;}),S.S.end());
+}
+
+inline void Blow(state &S,const vec &hit)noexcept{
+    auto barrel_it=find_if(S.B.begin(),S.B.end(),[&](const barrel &b){return b.r==hit;});
+    auto mine_it=find_if(S.M.begin(),S.M.end(),[&](const mine &m){return m.r==hit;});
+    if(barrel_it!=S.B.end()){
+        S.B.erase(barrel_it);
+    }
+    else if(mine_it!=S.M.end()){
+        S.M.erase(mine_it);
+        for_each(S.S.begin(),S.S.end(),[&](ship &s){Splash(s,hit);});
+    }
+    else{
+        for_each(S.S.begin(),S.S.end(),[&](ship &s){Ship_Blow(s,hit);});
+    }
+}
+
+inline bool Free(const state &S,const vec &r)noexcept{
+    const bool no_barrel{find_if(S.B.begin(),S.B.end(),[&](const barrel &b){return b.r==r;})==S.B.end()};
+    const bool no_mine{find_if(S.M.begin(),S.M.end(),[&](const mine &m){return m.r==r;})==S.M.end()};
+    const bool no_ship{find_if(S.S.begin(),S.S.end(),[&](const ship &ship){return Occupies(ship,r);})==S.S.end()};
+    return no_barrel && no_ship && no_mine;
+}
+
+inline void Simulate(state &S,const array<strat,2> &M){
+    map<int,int> RumToDrop;
+    for(ship &s:S.S){//Accelerations, decelerations, rum decrease
+        --s.rum;
+        RumToDrop[s.id]=min(30,s.rum);
+        const play &mv=M[s.owner].at(s.id);
+        if(mv.type==SLOWER){
+            s.speed=max(0,s.speed-1);
+        }
+        else if(mv.type==FASTER){
+            s.speed=min(2,s.speed+1);
+        }
+        else if(mv.type==FIRE && s.cd==0 && Distance(Bow(s),mv.target)<=10){
+            S.C.push_back(cannonball{S.entityId++,s.id,mv.target,2+static_cast<int>(round(Distance(Bow(s),mv.target)/3.0))});//2 because i move cannonballs after
+            s.cd=2;
+        }
+        else if(mv.type==MINE && s.mine_cd==0){
+            vec mine_spot=Step(Stern(s),Reverse(s.angle));
+            if(Inside(mine_spot) && Free(S,mine_spot)){
+                S.M.push_back(mine{S.entityId++,mine_spot});
+                s.mine_cd=5;
+            }
+        }
+        s.cd=max(0,s.cd-1);
+        s.mine_cd=max(0,s.mine_cd-1);
+    }
+    //Movement and collisions
+    for(int spd=1;spd<=2;++spd){
+        vector<ship> S_Before=S.S;
+        for(ship &s:S.S){
+            if(s.speed>=spd){
+                vec next=Step(s.r,s.angle);
+                if(Inside(next)){
+                    s.r=next;
+                }
+                else{
+                    s.speed=0;
+                }
+            }
+        }
+        while(true){
+            vector<int> colliding_boats;
+            for(int i=0;i<S.S.size();++i){
+                const ship &s=S.S[i];
+                if(s.speed>=spd){
+                    for(int j=0;j<S.S.size();++j){
+                        if(i!=j){//Don't check collisions with yourself
+                            const ship &s2=S.S[j];
+                            const vec new_front=Bow(s);
+                            if(Occupies(s2,new_front)){//Collision
+                                colliding_boats.push_back(i);
+                                if(Bow(s2)==Bow(s)){
+                                    colliding_boats.push_back(j);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+            for(const int a:colliding_boats){
+                ship &s=S.S[a];
+                s.speed=0;//Stop ship
+                s.r=S_Before[a].r;//Put back in original position
+            }
+            if(colliding_boats.size()==0){
+                break;
+            }
+        }
+        for(ship &s:S.S){
+            if(s.speed>=spd){
+                const vec new_front=Bow(s);
+                auto barrel_it=find_if(S.B.begin(),S.B.end(),[&](const barrel &b){return b.r==new_front;});
+                if(barrel_it!=S.B.end()){
+                    const barrel &b=*barrel_it;
+                    s.rum=min(100,s.rum+b.rum);
+                    S.B.erase(barrel_it);
+                }
+                auto mine_it=find_if(S.M.begin(),S.M.end(),[&](const mine &m){return m.r==new_front;});
+                if(mine_it!=S.M.end()){
+                    s.rum-=25;
+                    for_each(S.S.begin(),S.S.end(),[&](ship &s2){if(s2.id!=s.id)Splash(s2,mine_it->r);});
+                    S.M.erase(mine_it);
+                }
+            }
+        }
+    }
+    //Turns
+    vector<ship> S_Before=S.S;
+    for(ship &s:S.S){
+        const play &mv=M[s.owner].at(s.id);
+        if(mv.type==STARBOARD || mv.type==PORT){//Rotation
+            if(mv.type==STARBOARD){
+                s.angle=s.angle==0?5:s.angle-1;
+            }
+            else if(mv.type==PORT){
+                s.angle=s.angle==5?0:s.angle+1;
+            }
+        }
+    }
+    while(true){
+        vector<int> colliding_boats;
+        for(int i=0;i<S.S.size();++i){
+            const ship &s=S.S[i];
+            const play &mv=M[s.owner].at(s.id);
+            if(mv.type==STARBOARD || mv.type==PORT){//Rotation
+                for(int j=0;j<S.S.size();++j){
+                    if(j!=i){//Don't check collision with yourself
+                        const ship &s2=S.S[j];
+                        const vec new_front=Bow(s),new_front2=Bow(s2),new_back=Stern(s),new_back2=Stern(s2);
+                        if(Occupies(s,new_front2) || Occupies(s2,new_front) || Occupies(s,new_back2) || Occupies(s2,new_back)){//Collision
+                            colliding_boats.push_back(i);
+                            colliding_boats.push_back(j);
+                        } 
+                    }
+                }
+            }
+        }
+        for(const int a:colliding_boats){
+            ship &s=S.S[a];
+            s.speed=0;//Stop ship
+            s.angle=S_Before[a].angle;
+        }
+        if(colliding_boats.size()==0){
+            break;
+        }
+    }
+    for(ship &s:S.S){
+        const play &mv=M[s.owner].at(s.id);
+        if(mv.type==STARBOARD || mv.type==PORT){//Rotation
+            const vec new_front=Bow(s),new_back=Stern(s);
+            auto barrel_it=find_if(S.B.begin(),S.B.end(),[&](const barrel &b){return b.r==new_front || b.r==new_back;});
+            if(barrel_it!=S.B.end()){
+                const barrel &b=*barrel_it;
+                s.rum=min(100,s.rum+b.rum);
+                S.B.erase(barrel_it);
+            }
+            auto mine_it=find_if(S.M.begin(),S.M.end(),[&](const mine &m){return m.r==new_front || m.r==new_back;});
+            if(mine_it!=S.M.end()){
+                s.rum-=25;
+                for_each(S.S.begin(),S.S.end(),[&](ship &s2){if(s2.id!=s.id)Splash(s2,mine_it->r);});
+                S.M.erase(mine_it);
+            }
+        }
+    }
+    for(cannonball &c:S.C){
+        --c.turns;
+        if(c.turns==0){
+            Blow(S,c.target);
+        }
+    }
+    for(const ship &s:S.S){
+        if(s.rum<=0 && RumToDrop[s.id]>0){
+            S.B.push_back(barrel{S.entityId++,s.r,RumToDrop[s.id]});
+        }
+    }
+    Purge(S);
+}
+
+}
@@ -0,0 +1,159 @@
+//Offline viewer for replay files written by Arena --replay
+//Replay file: lists the recorded games
+//Replay file game: prints every turn of a game as an ASCII map followed by what the bots printed
+//Replay file game --json: exports the game as JSON
+#include <iostream>
+#include <iomanip>
+#include "../Replay.h"
+using namespace std;
+
+void List(replay_reader &Reader){
+    replay R;
+    for(int game=0;Reader.Next(R);++game){
+        cout << game << ": seed " << R.seed << " " << R.names[0] << " vs " << R.names[1] << " winner " << (R.winner==-1?"draw":R.names[R.winner]) << (R.outcome!=NORMAL?" "+Outcome2Str[R.outcome]:"") << " " << R.count << " turns";
+        if(R.stratum>=0){
+            cout << " stratum " << R.stratum;
+        }
+        cout << endl;
+    }
+}
+
+void Print_Map(const state &S){//Odd rows are shifted by half a cell like on the hexagonal grid
+    vector<string> Map(H,string(W,'.'));
+    auto Set=[&](const vec &r,const char c){
+        if(Valid<default_board>(r)){
+            Map[r.y][r.x]=c;
+        }
+    };
+    for(const mine &m:S.M){
+        Set(m.r,'*');
+    }
+    for(const barrel &b:S.B){
+        Set(b.r,'$');
+    }
+    for(const cannonball &c:S.C){
+        Set(c.target,'+');
+    }
+    for(const ship &s:S.S){
+        const char body{s.owner==0?'a':'b'};
+        Set(s.front(),body);
+        Set(s.back(),body);
+        Set(s.r,toupper(body));
+    }
+    for(int y=0;y<H;++y){
+        cout << (y%2==1?" ":"");
+        for(const char c:Map[y]){
+            cout << c << " ";
+        }
+        cout << endl;
+    }
+    for(const ship &s:S.S){
+        cout << "ship " << s.id << " player " << s.owner << " at " << s.r << " angle " << s.angle << " speed " << s.speed << " rum " << s.rum << endl;
+    }
+}
+
+void Print_Game(const replay &R){
+    cout << "seed " << R.seed << " A: " << R.names[0] << " B: " << R.names[1] << endl;
+    for(int i=0;i<R.count;++i){
+        const replay_turn &T=R[i];
+        cout << "Turn " << T.turn << endl;
+        Print_Map(T.S);
+        for(int j=0;j<N;++j){
+            cout << R.names[j] << " output:" << endl << T.output[j];
+            if(!T.error[j].empty()){
+                cout << R.names[j] << " stderr:" << endl << T.error[j];
+            }
+        }
+        cout << endl;
+    }
+    cout << "Final state" << endl;
+    Print_Map(R.final);
+    cout << "Winner: " << (R.winner==-1?"draw":R.names[R.winner]) << " Outcome: " << Outcome2Str[R.outcome] << endl;
+}
+
+string Json(const string &str){
+    stringstream ss;
+    ss << '"';
+    for(const char c:str){
+        if(c=='"' || c=='\\'){
+            ss << '\\' << c;
+        }
+        else if(c=='\n'){
+            ss << "\\n";
+        }
+        else if(static_cast<unsigned char>(c)<0x20){
+            ss << "\\u" << hex << setw(4) << setfill('0') << static_cast<int>(c) << dec;
+        }
+        else{
+            ss << c;
+        }
+    }
+    ss << '"';
+    return ss.str();
+}
+
+string Json(const state &S){
+    stringstream ss;
+    ss << "{\"ships\":[";
+    for(int i=0;i<S.S.size();++i){
+        const ship &s=S.S[i];
+        ss << (i>0?",":"") << "{\"id\":" << s.id << ",\"owner\":" << s.owner << ",\"x\":" << s.r.x << ",\"y\":" << s.r.y << ",\"angle\":" << s.angle << ",\"speed\":" << s.speed << ",\"rum\":" << s.rum << ",\"cd\":" << s.cd << ",\"mine_cd\":" << s.mine_cd << "}";
+    }
+    ss << "],\"barrels\":[";
+    for(int i=0;i<S.B.size();++i){
+        const barrel &b=S.B[i];
+        ss << (i>0?",":"") << "{\"id\":" << b.id << ",\"x\":" << b.r.x << ",\"y\":" << b.r.y << ",\"rum\":" << b.rum << "}";
+    }
+    ss << "],\"mines\":[";
+    for(int i=0;i<S.M.size();++i){
+        const mine &m=S.M[i];
+        ss << (i>0?",":"") << "{\"id\":" << m.id << ",\"x\":" << m.r.x << ",\"y\":" << m.r.y << "}";
+    }
+    ss << "],\"cannonballs\":[";
+    for(int i=0;i<S.C.size();++i){
+        const cannonball &c=S.C[i];
+        ss << (i>0?",":"") << "{\"id\":" << c.id << ",\"shooter\":" << c.shooter_id << ",\"x\":" << c.target.x << ",\"y\":" << c.target.y << ",\"turns\":" << c.turns << "}";
+    }
+    ss << "]}";
+    return ss.str();
+}
+
+void Print_Json(const replay &R){
+    cout << "{\"seed\":" << R.seed << ",\"stratum\":" << R.stratum << ",\"players\":[" << Json(R.names[0]) << "," << Json(R.names[1]) << "],\"winner\":" << R.winner << ",\"outcome\":\"" << Outcome2Str[R.outcome] << "\",\"turns\":[";
+    for(int i=0;i<R.count;++i){
+        const replay_turn &T=R[i];
+        cout << (i>0?",":"") << "{\"turn\":" << T.turn << ",\"state\":" << Json(T.S) << ",\"output\":[" << Json(T.output[0]) << "," << Json(T.output[1]) << "],\"stderr\":[" << Json(T.error[0]) << "," << Json(T.error[1]) << "]}";
+    }
+    cout << "],\"final\":" << Json(R.final) << "}" << endl;
+}
+
+int main(int argc,char **argv){
+    if(argc<2){
+        cerr << "Usage: Replay file [game [--json]]" << endl;
+        return 1;
+    }
+    replay_reader Reader(argv[1]);
+    if(!Reader.good()){
+        return 1;
+    }
+    if(argc==2){
+        List(Reader);
+        return 0;
+    }
+    const int game{atoi(argv[2])};
+    const bool json{argc>=4 && string(argv[3])=="--json"};
+    replay R;
+    for(int i=0;Reader.Next(R);++i){
+        if(i==game){
+            if(json){
+                Print_Json(R);
+            }
+            else{
+                Print_Game(R);
+            }
+            return 0;
+        }
+    }
+    cerr << "There are fewer than " << game+1 << " games in " << argv[1] << endl;
+    return 1;
+}